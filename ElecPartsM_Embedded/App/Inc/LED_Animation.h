@@ -0,0 +1,68 @@
+#ifndef LED_ANIMATION_H
+#define LED_ANIMATION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "main.h"
+#include "WS2812B_Driver.h"
+#include "LED_Effect.h"
+#include "LED_Flash.h"
+
+// Keyframe animations uploaded once and kept in flash, one page per animation
+#define LED_ANIMATION_FLASH_BASE LED_FLASH_ANIMATIONS
+#define LED_ANIMATION_SLOT_NUM   4
+#define LED_ANIMATION_SLOT_SIZE  FLASH_PAGE_SIZE
+#define LED_ANIMATION_MAGIC      0xA41EU
+// Playback advances on the effect tick
+#define LED_ANIMATION_TICK_MS    LED_EFFECT_TICK_MS
+
+// LED_AnimationHeader.Flags
+#define LED_ANIMATION_LOOP 0x0001U
+
+// Color of an LED range at a point in time. Consecutive keyframes on the same range form a track
+// and the range fades linearly between them; times must rise within a track.
+typedef struct {
+    uint16_t Time_ms; // from the start of the animation
+    uint16_t First;
+    uint8_t Count;
+    uint8_t G;
+    uint8_t R;
+    uint8_t B;
+} LED_Keyframe;
+
+// Start of a flash slot, the keyframes follow it. Programmed last so a partial upload stays invalid.
+typedef struct {
+    uint16_t Magic;
+    uint16_t KeyNum;
+    uint16_t Duration_ms;
+    uint16_t Flags;
+} LED_AnimationHeader;
+
+#define LED_ANIMATION_MAX_KEYS \
+    ((LED_ANIMATION_SLOT_SIZE - sizeof(LED_AnimationHeader)) / sizeof(LED_Keyframe))
+
+typedef struct {
+    LED_Layers *Layers;                 // drawn into their base, beneath the highlight layers
+    const LED_AnimationHeader *Playing; // NULL when stopped
+    uint32_t Time_ms;                   // position in the playing animation
+    volatile uint16_t PendingTicks;     // ticks counted by the timer, not rendered yet
+    uint8_t UploadSlot;                 // slot being written, LED_ANIMATION_SLOT_NUM when none
+    uint16_t UploadKeys;                // keyframes programmed into it so far
+} LED_Animation;
+
+WS2812B_Result LED_Animation_Init(LED_Animation *anim, LED_Layers *layers);
+WS2812B_Result LED_Animation_BeginUpload(LED_Animation *anim, uint8_t slot);
+WS2812B_Result LED_Animation_AddKeyframe(LED_Animation *anim, const LED_Keyframe *key);
+WS2812B_Result LED_Animation_EndUpload(LED_Animation *anim, uint16_t duration_ms, uint16_t flags);
+WS2812B_Result LED_Animation_Play(LED_Animation *anim, uint8_t slot);
+void LED_Animation_Stop(LED_Animation *anim);
+void LED_Animation_StopSlot(LED_Animation *anim, uint8_t slot);
+void LED_Animation_TickIT(LED_Animation *anim);
+void LED_Animation_Process(LED_Animation *anim);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LED_ANIMATION_H */
@@ -0,0 +1,47 @@
+#ifndef LED_EFFECT_H
+#define LED_EFFECT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "main.h"
+#include "WS2812B_Driver.h"
+#include "LED_Layer.h"
+
+// Effects running at the same time, each one covers a range of LEDs
+#define LED_EFFECT_MAX_NUM 16
+// Period of the TIM1 update tick advancing the effects
+#define LED_EFFECT_TICK_MS 10
+
+typedef enum {
+    LED_Effect_None = 0,
+    LED_Effect_Blink,   // whole range on for the first half of the period, off for the second
+    LED_Effect_Breathe, // whole range fades in and out once per period
+    LED_Effect_Chase    // one LED of the range lit, walking through the range once per period
+} LED_EffectType;
+
+// Effect table, one array per field so a tick walks small contiguous arrays
+typedef struct {
+    LED_Layers *Layers; // drawn into their base, beneath the highlight layers
+    uint8_t Type[LED_EFFECT_MAX_NUM];
+    uint16_t First[LED_EFFECT_MAX_NUM];
+    uint16_t Count[LED_EFFECT_MAX_NUM];
+    LED_Color Color[LED_EFFECT_MAX_NUM];
+    uint16_t Phase[LED_EFFECT_MAX_NUM]; // position in the period, Q0.16 of a full cycle
+    uint16_t Step[LED_EFFECT_MAX_NUM];  // phase advance per tick, 65536 / period ticks
+    volatile uint16_t PendingTicks;     // ticks counted by the timer, not rendered yet
+} LED_Effects;
+
+WS2812B_Result LED_Effect_Init(LED_Effects *fx, LED_Layers *layers);
+WS2812B_Result LED_Effect_Start(LED_Effects *fx, LED_EffectType type, uint16_t first, uint16_t count,
+                                LED_Color color, uint16_t period_ms);
+WS2812B_Result LED_Effect_Stop(LED_Effects *fx, uint16_t first);
+void LED_Effect_StopAll(LED_Effects *fx);
+void LED_Effect_TickIT(LED_Effects *fx);
+void LED_Effect_Process(LED_Effects *fx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LED_EFFECT_H */
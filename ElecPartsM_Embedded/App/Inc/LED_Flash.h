@@ -0,0 +1,22 @@
+#ifndef LED_FLASH_H
+#define LED_FLASH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "main.h"
+
+/* Flash pages kept for data uploaded over UnitCommute, at the end of the 64KB flash.
+ * The linker ROM size (uvprojx IROM / eide storageLayout / .sct) stops at LED_FLASH_BASE. */
+#define LED_FLASH_BASE        0x0800EC00UL
+#define LED_FLASH_SLOT_TABLE  LED_FLASH_BASE            // one page
+#define LED_FLASH_ANIMATIONS  (LED_FLASH_BASE + 0x400U) // LED_ANIMATION_SLOT_NUM pages
+
+HAL_StatusTypeDef LED_Flash_ErasePage(uint32_t address);
+HAL_StatusTypeDef LED_Flash_Program(uint32_t address, const void *data, uint16_t bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LED_FLASH_H */
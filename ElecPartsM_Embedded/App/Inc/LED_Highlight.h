@@ -0,0 +1,49 @@
+#ifndef LED_HIGHLIGHT_H
+#define LED_HIGHLIGHT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "main.h"
+#include "WS2812B_Driver.h"
+#include "LED_Effect.h"
+
+// Highlights lit at the same time, with or without an expiry
+#define LED_HIGHLIGHT_MAX_NUM 32
+// Expiries advance on the effect tick
+#define LED_HIGHLIGHT_TICK_MS LED_EFFECT_TICK_MS
+
+/* Hierarchical timing wheel: level n slots are 2^(n*BITS) ticks wide, entries move down a level
+ * when the level below wraps, so a tick only touches the entries that expire or cascade in it.
+ * 4 levels of 32 slots reach 2^20 ticks, about 2.9 hours. */
+#define LED_HIGHLIGHT_WHEEL_LEVELS 4
+#define LED_HIGHLIGHT_WHEEL_BITS   5
+#define LED_HIGHLIGHT_WHEEL_SLOTS  (1 << LED_HIGHLIGHT_WHEEL_BITS)
+#define LED_HIGHLIGHT_MAX_TICKS    ((1UL << (LED_HIGHLIGHT_WHEEL_LEVELS * LED_HIGHLIGHT_WHEEL_BITS)) - 1)
+#define LED_HIGHLIGHT_NONE         0xFF
+
+typedef struct {
+    LED_Layers *Layers; // drawn into their base, beneath the highlight layers
+    uint8_t Wheel[LED_HIGHLIGHT_WHEEL_LEVELS * LED_HIGHLIGHT_WHEEL_SLOTS]; // first entry of each slot list
+    // Entries, one array per field. Count 0 marks a free entry.
+    uint8_t Next[LED_HIGHLIGHT_MAX_NUM];  // slot lists, linked both ways for O(1) removal
+    uint8_t Prev[LED_HIGHLIGHT_MAX_NUM];
+    uint8_t Where[LED_HIGHLIGHT_MAX_NUM]; // wheel slot holding the entry, NONE for untimed ones
+    uint16_t First[LED_HIGHLIGHT_MAX_NUM];
+    uint16_t Count[LED_HIGHLIGHT_MAX_NUM];
+    uint32_t Expiry[LED_HIGHLIGHT_MAX_NUM]; // tick the range is switched off in, timed entries only
+    uint32_t Now;                    // next tick to process
+    volatile uint16_t PendingTicks;  // ticks counted by the timer, not processed yet
+} LED_Highlights;
+
+WS2812B_Result LED_Highlight_Init(LED_Highlights *hl, LED_Layers *layers);
+WS2812B_Result LED_Highlight_Set(LED_Highlights *hl, uint16_t first, uint16_t count, LED_Color color,
+                                 uint32_t timeout_ms);
+void LED_Highlight_TickIT(LED_Highlights *hl);
+void LED_Highlight_Process(LED_Highlights *hl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LED_HIGHLIGHT_H */
@@ -0,0 +1,56 @@
+#ifndef LED_LAYER_H
+#define LED_LAYER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "main.h"
+#include "WS2812B_Driver.h"
+
+/* Highlight layers, one per requester, composited into the strip framebuffer.
+ * A higher layer covers the ones below, an additive layer adds its color on top of them instead.
+ * The layers lie over Base, where the effects, animation, highlights and slots draw through
+ * LED_Layer_Draw: an LED keeps its base color while covered and gets it back once no layer covers it.
+ * Drawing and layer changes only widen a dirty range, LED_Layer_Process composites that range
+ * and commits the strip once for everything changed in the pass. */
+#define LED_LAYER_MAX_NUM 4
+// Ranges one layer can hold, ranges of a layer never overlap
+#define LED_LAYER_MAX_ENTRIES 8
+
+#if LED_LAYER_MAX_NUM > 4
+#error "The per LED layer mask holds 4 layers"
+#endif
+
+typedef enum {
+    LED_Layer_Opaque = 0, // hides the layers below on the LEDs it covers
+    LED_Layer_Add         // adds to the layers below, saturating
+} LED_LayerMode;
+
+typedef struct {
+    WS2812B *Strip;
+    LED_Color *Base; // caller supplied, Strip->LED_Num colors shown under the layers
+    uint16_t DirtyFirst; // LEDs [DirtyFirst, DirtyEnd) need compositing again, empty when DirtyFirst >= DirtyEnd
+    uint16_t DirtyEnd;
+    uint8_t Mode[LED_LAYER_MAX_NUM];
+    // Entries of each layer, Count 0 marks a free one
+    uint16_t First[LED_LAYER_MAX_NUM][LED_LAYER_MAX_ENTRIES];
+    uint8_t Count[LED_LAYER_MAX_NUM][LED_LAYER_MAX_ENTRIES];
+    LED_Color Color[LED_LAYER_MAX_NUM][LED_LAYER_MAX_ENTRIES];
+    // Bit n set while layer n covers the LED, two LEDs per byte, even LEDs in the low nibble
+    uint8_t Mask[(WS2812B_MAX_LED_NUM + 1) / 2];
+    uint8_t CommitPending; // composited changes the strip was too busy to take
+} LED_Layers;
+
+WS2812B_Result LED_Layer_Init(LED_Layers *layers, WS2812B *strip, LED_Color *base);
+WS2812B_Result LED_Layer_SetMode(LED_Layers *layers, uint8_t layer, LED_LayerMode mode);
+WS2812B_Result LED_Layer_Set(LED_Layers *layers, uint8_t layer, uint16_t first, uint16_t count, LED_Color color);
+WS2812B_Result LED_Layer_Clear(LED_Layers *layers, uint8_t layer, uint16_t first, uint16_t count);
+WS2812B_Result LED_Layer_ClearAll(LED_Layers *layers, uint8_t layer);
+WS2812B_Result LED_Layer_Draw(LED_Layers *layers, uint16_t first, uint16_t count, LED_Color color);
+void LED_Layer_Process(LED_Layers *layers);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LED_LAYER_H */
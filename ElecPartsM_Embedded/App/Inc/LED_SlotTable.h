@@ -0,0 +1,34 @@
+#ifndef LED_SLOT_TABLE_H
+#define LED_SLOT_TABLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "main.h"
+#include "WS2812B_Driver.h"
+#include "LED_Layer.h"
+#include "LED_Flash.h"
+
+/* Logical slots (drawers, bins) mapped to LED ranges, so the host addresses a slot instead of LEDs.
+ * The table is read straight from its flash page: erased entries read 0xFFFF and are unmapped,
+ * each entry can be programmed once after LED_SlotTable_Erase. */
+// 256 with 1KB pages, slots are addressed with one byte and every value is a table entry
+#define LED_SLOT_MAX_NUM (FLASH_PAGE_SIZE / sizeof(LED_SlotRange))
+#define LED_SLOT_UNMAPPED 0xFFFFU
+
+typedef struct {
+    uint16_t First;
+    uint16_t Count;
+} LED_SlotRange;
+
+WS2812B_Result LED_SlotTable_Erase(void);
+WS2812B_Result LED_SlotTable_Map(uint8_t slot, uint16_t first, uint16_t count);
+WS2812B_Result LED_SlotTable_Get(uint8_t slot, uint16_t *first, uint16_t *count);
+WS2812B_Result LED_Slot_Set(LED_Layers *layers, uint8_t slot, LED_Color color);
+WS2812B_Result LED_Slot_Clear(LED_Layers *layers, uint8_t slot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LED_SLOT_TABLE_H */
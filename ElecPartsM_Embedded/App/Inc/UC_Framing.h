@@ -0,0 +1,27 @@
+#ifndef UC_FRAMING_H
+#define UC_FRAMING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <stdint.h>
+
+/* Wire format of UnitCommute frames: COBS(frame bytes, CRC-8) followed by a 0x00 delimiter.
+ * COBS removes every 0x00 from the encoded bytes, so payloads are binary safe and a receiver
+ * resyncs at the next delimiter. No HAL dependency, host tools build this file as is. */
+#define UC_FRAME_DELIMITER 0x00
+// CRC-8, polynomial x^8 + x^2 + x + 1, initial value 0
+#define UC_FRAMING_CRC_POLY 0x07
+
+// Encoded size of a frame of n bytes: CRC, one code byte per started 254 byte block, delimiter
+#define UC_FRAMING_MAX_ENCODED(n) ((n) + 3 + ((n) + 1) / 254)
+
+uint8_t UC_Framing_CRC8(const uint8_t *data, uint16_t length);
+uint16_t UC_Framing_Encode(const uint8_t *frame, uint16_t length, uint8_t *out);
+uint16_t UC_Framing_Decode(uint8_t *buf, uint16_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UC_FRAMING_H */
@@ -0,0 +1,53 @@
+#ifndef UC_PORT_H
+#define UC_PORT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "main.h"
+#include "usart.h"
+
+// Chain ports: USART1 towards the host (upstream), USART2 towards the next unit
+#define UC_PORT_NUM 2
+// Receive ring per port, holds several frames arriving back to back
+#define UC_PORT_RX_SIZE 64
+// Transmit queue per port, outgoing and forwarded frames wait here while the UART sends.
+// Twice the receive ring, so an idle queue takes a whole received burst being forwarded.
+#define UC_PORT_TX_SIZE (2 * UC_PORT_RX_SIZE)
+
+/* Reception runs continuously into the ring and reports once per burst (idle line, or half / full
+ * ring). A port with a DMA channel linked to hdmarx receives through circular DMA, the others
+ * through HAL_UARTEx_ReceiveToIdle_IT restarted behind the received data. */
+typedef struct {
+    UART_HandleTypeDef *Handle;
+    uint8_t RxRing[UC_PORT_RX_SIZE];
+    volatile uint16_t RxHead; // write position, advanced by the reception events
+    uint16_t RxTail;          // read position of the main loop
+    uint16_t RxStart;         // interrupt mode: ring position the running reception started at
+    volatile uint8_t RxRestarted; // DMA mode: reception restarted at the ring start, the reader follows
+    volatile uint32_t RxTotal; // bytes received up to RxHead, counted by the reception events
+    uint32_t RxRead;           // bytes taken by the reader, RxTotal - RxRead are unread
+    uint32_t RxErrors;        // receptions restarted after a UART error
+    uint32_t RxOverruns;      // reads that found unread bytes overwritten and skipped the ring
+    /* Transmission drains the queue in the background, through DMA when a channel is linked to
+     * hdmatx, by interrupt otherwise. Each transfer sends the queued bytes up to the ring end
+     * and the completion callback chains the next one. */
+    uint8_t TxRing[UC_PORT_TX_SIZE];
+    uint16_t TxHead;           // write position of the main loop
+    volatile uint16_t TxTail;  // start of the bytes not sent yet
+    volatile uint16_t TxLength; // bytes of the running transfer, 0 when idle
+} UC_Port;
+
+HAL_StatusTypeDef UC_Port_Init(UC_Port *port);
+uint16_t UC_Port_Read(UC_Port *port, uint8_t *data, uint16_t size, uint8_t *lost);
+HAL_StatusTypeDef UC_Port_Write(UC_Port *port, const uint8_t *data, uint16_t size);
+void UC_Port_TxCpltIT(UC_Port *port);
+void UC_Port_RxEventIT(UC_Port *port, uint16_t size);
+void UC_Port_ErrorIT(UC_Port *port);
+UC_Port *UC_Port_Find(UART_HandleTypeDef *huart);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UC_PORT_H */
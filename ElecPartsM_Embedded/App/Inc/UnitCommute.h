@@ -1,10 +1,16 @@
 #ifndef UnitCommute_H__
 #define UnitCommute_H__
 #include "main.h"
+#include "UC_Framing.h"
 
 enum UC_Command{
-    UC_HighlightPart = 0x1,
+    UC_HighlightPart = 0x1, // msg: enum UC_HighlightMsg
     UC_SetLED = 0x2,
+    UC_StartEffect = 0x3, // msg: LED_EffectType, data: strip first(2) count R G B period_ms(2), big endian
+    UC_Animation = 0x4,   // msg: enum UC_AnimationMsg
+    UC_SlotTable = 0x5,   // msg: enum UC_SlotTableMsg
+    UC_Layer = 0x6,       // msg: layer, data: strip first(2) count R G B sets, strip first(2) count clears,
+                          // strip alone clears the layer, strip LED_LayerMode sets how the layer blends
 
     UC_SetID = 0xA,
     UC_ClearID = 0xB,
@@ -13,6 +19,33 @@ enum UC_Command{
     UC_ExtendCommand = 0xE
 };
 
+/* The LED commands (highlight, slot set and clear, effect, animation, layer) start their data with
+ * the strip, the shelf row below WS2812B_MAX_STRIP_NUM they address. Commands naming a strip the
+ * unit does not have are ignored. */
+
+// Addressing of UC_HighlightPart, multi-byte fields big endian, no timeout keeps the part lit
+enum UC_HighlightMsg{
+    UC_HighlightRange = 0x0, // data: strip first(2) count R G B [timeout_100ms(2)]
+    UC_HighlightSlot = 0x1   // data: strip slot R G B [timeout_100ms(2)]
+};
+
+// Subcommands of UC_SlotTable
+enum UC_SlotTableMsg{
+    UC_SlotErase = 0x0, // no data, unmaps every slot
+    UC_SlotMap = 0x1,   // data: slot first(2) count, up to two entries per frame
+    UC_SlotSet = 0x2,   // data: strip slot R G B
+    UC_SlotClear = 0x3  // data: strip slot
+};
+
+// Subcommands of UC_Animation, multi-byte fields big endian
+enum UC_AnimationMsg{
+    UC_AnimStop = 0x0,  // data: strip
+    UC_AnimPlay = 0x1,  // data: strip slot
+    UC_AnimBegin = 0x2, // data: strip slot, erases it for the keyframes that follow
+    UC_AnimKey = 0x3,   // data: strip time_ms(2) first(2) count R G B, checked against that strip
+    UC_AnimEnd = 0x4    // data: strip duration_ms(2) flags, stores the animation, any strip can play it
+};
+
 enum UC_SendDirection{
     UC_Downstream = 0,
     UC_Upstream = 1
@@ -30,11 +63,37 @@ typedef struct UC_Frame_t{
     uint8_t *OptData;
 } UC_Frame;
 
-#define UC_FRAME_MAX_SIZE 10
+// Frame bytes (id, cmd/msg, data) before encoding, and as received before a delimiter
+#define UC_FRAME_MAX_SIZE 11
+#define UC_FRAME_ENCODED_SIZE (UC_FRAMING_MAX_ENCODED(UC_FRAME_MAX_SIZE) - 1)
+// Chain ports a frame can arrive from, UART1: 1, UART2: 2
+#define UC_DIRECTION_NUM 2
+
+// Frame assembly state of one port, so frames from both ports can build up at the same time
+typedef struct UC_Parser_t{
+    uint8_t FrameBuf[UC_FRAME_ENCODED_SIZE]; // encoded, decoded in place at the delimiter
+    uint8_t Length;
+    uint8_t Overflow; // frame longer than FrameBuf or missing bytes, skipped up to its delimiter
+    uint8_t Forwarding; // frame for another unit, streamed to the other port up to its delimiter
+    uint16_t Dropped;   // frames failing the COBS decode or the CRC
+} UC_Parser;
+
+// Local frames held for one outbound port while a cut-through forward owns it
+#define UC_OUTBOX_SIZE (2 * UC_FRAMING_MAX_ENCODED(UC_FRAME_MAX_SIZE))
+typedef struct UC_Outbox_t{
+    uint8_t Held[UC_OUTBOX_SIZE]; // encoded frames, sent once the forward reaches its delimiter
+    uint8_t Length;
+    uint8_t ForwardOpen; // a forwarded frame is partly queued on the port
+    uint8_t Truncated;   // the port fell behind mid forward, a delimiter ending the partial frame is owed
+    uint16_t Dropped;    // local frames that found Held full
+} UC_Outbox;
 
 extern UnitData unitData;
 
-void ProcessUC_Frame(uint8_t length);
+void UC_Receive(uint8_t direction, const uint8_t *data, uint16_t length);
+void UC_Resync(uint8_t direction);
+void UC_Process(void);
+void ProcessUC_Frame(uint8_t direction, uint8_t *buf, uint8_t length);
 
 
 #endif /* UnitCommute_H__ */
\ No newline at end of file
@@ -5,39 +5,174 @@
 extern "C" {
 #endif
 #include "main.h"
+#include "spi.h"
+#include "tim.h"
+#include "WS2812B_Timing.h"
 
-#define WS2812B_MAX_LED_NUM 15
+// Upper bound of WS2812B.LED_Num, the framebuffers themselves are sized by the caller
+#define WS2812B_MAX_LED_NUM 300
+// Strips that can be registered by WS2812B_Init, each on its own output
+#define WS2812B_MAX_STRIP_NUM 2
+
+// Map colors through a 2.2 gamma curve on the way out, 0 sends them linear
+#define WS2812B_GAMMA_CORRECTION 1
+// Current drawn by one LED channel at full duty, for the current limiter
+#define WS2812B_MA_PER_CHANNEL 20
+
+// Framebuffer format: 0 stores a full LED_Color per LED, 4 or 8 stores a palette index per LED
+#ifndef WS2812B_PALETTE_BITS
+#define WS2812B_PALETTE_BITS 0
+#endif
+#if WS2812B_PALETTE_BITS
+#if WS2812B_PALETTE_BITS != 4 && WS2812B_PALETTE_BITS != 8
+#error "WS2812B_PALETTE_BITS must be 0, 4 or 8"
+#endif
+#define WS2812B_PALETTE_SIZE (1 << WS2812B_PALETTE_BITS)
+#endif
+
+#if WS2812B_SPI_3BIT_SYMBOLS
+typedef uint8_t WS2812B_SPI_Word;
+#define WS2812B_SPI_SLOT_LEN (WS2812B_BITS_PER_LED * 3 / 8)
+#else
+typedef uint16_t WS2812B_SPI_Word;
+#define WS2812B_SPI_SLOT_LEN WS2812B_BITS_PER_LED
+#endif
+#define WS2812B_SPI_SLOT_BYTES (WS2812B_SPI_SLOT_LEN * sizeof(WS2812B_SPI_Word))
+
+// TIM backend: one compare byte per LED bit
+#define WS2812B_TIM_SLOT_LEN    WS2812B_BITS_PER_LED
+#define WS2812B_TIM_SLOT_BYTES  WS2812B_TIM_SLOT_LEN
+
+// Ping-pong DMA buffer: two slots of one LED each, refilled from the half/complete interrupts
+#define WS2812B_SLOT_MAX_BYTES \
+    ((WS2812B_SPI_SLOT_BYTES > WS2812B_TIM_SLOT_BYTES) ? WS2812B_SPI_SLOT_BYTES : WS2812B_TIM_SLOT_BYTES)
+#define WS2812B_DMA_BUFFER_WORDS ((2 * WS2812B_SLOT_MAX_BYTES + 3) / 4)
 
 typedef enum {
     WS2812B_Idle = 0,
+    WS2812B_Queued,       // refresh requested, waiting for another strip to free the DMA channel
     WS2812B_Buffering,
     WS2812B_Transmitting,
-    WS2812B_Refreshing
+    WS2812B_Refreshing,
+    WS2812B_Latching      // DMA released, waiting for the reset window to end
 } WS2812B_Status;
 
 typedef enum {
     WS2812B_OK = 0,
-    WS2812B_Error
+    WS2812B_Error,
+    WS2812B_Busy  // the front buffer is being sent, try again later
 } WS2812B_Result;
 
 typedef struct {
     uint8_t G;
     uint8_t R;
     uint8_t B;
+#if WS2812B_RGBW
+    uint8_t W;
+#endif
 } LED_Color;
 
+static inline uint8_t WS2812B_SameColor(LED_Color a, LED_Color b){
+#if WS2812B_RGBW
+    return a.G == b.G && a.R == b.R && a.B == b.B && a.W == b.W;
+#else
+    return a.G == b.G && a.R == b.R && a.B == b.B;
+#endif
+}
+
+// Framebuffer element: packed palette indexes or full colors.
+// WS2812B_FRAME_LEN(leds) elements hold a frame of leds LEDs, e.g. static WS2812B_Pixel row[2][WS2812B_FRAME_LEN(60)]
+#if WS2812B_PALETTE_BITS
+typedef uint8_t WS2812B_Pixel;
+#define WS2812B_FRAME_LEN(leds) (((leds) * WS2812B_PALETTE_BITS + 7) / 8)
+#else
+typedef LED_Color WS2812B_Pixel;
+#define WS2812B_FRAME_LEN(leds) (leds)
+#endif
+#define WS2812B_FRAME_BYTES(leds) (WS2812B_FRAME_LEN(leds) * sizeof(WS2812B_Pixel))
+
+struct WS2812B_t;
+
+// Output backend, turns colors into DMA data and runs the circular transfer
 typedef struct {
-    uint8_t LED_Num;
-    WS2812B_Status Status;
-    LED_Color LEDs[WS2812B_MAX_LED_NUM];
+    uint8_t SlotLen;    // DMA transfers per LED
+    uint8_t SlotBytes;  // bytes per LED in the DMA buffer
+    uint8_t SlotLowUs;  // us the line is surely low once a zero slot after the data has been read
+    void (*EncodeLED)(uint8_t *slot, LED_Color color);
+    HAL_StatusTypeDef (*Start)(struct WS2812B_t *strip);
+    void (*Stop)(struct WS2812B_t *strip);
+    DMA_HandleTypeDef *(*GetDMA)(struct WS2812B_t *strip); // DMA channel feeding the output
+} WS2812B_Backend;
+
+extern const WS2812B_Backend WS2812B_SPI_Backend;
+extern const WS2812B_Backend WS2812B_TIM_Backend;
+
+typedef struct WS2812B_t {
+    uint16_t LED_Num;
+    volatile WS2812B_Status Status;
+    const WS2812B_Backend *Backend;
+    void *Handle;     // SPI_HandleTypeDef or TIM_HandleTypeDef of the backend
+    uint32_t Channel; // TIM channel, unused for SPI
+    TIM_HandleTypeDef *LatchTimer; // free running 1MHz timer timing the reset window
+    uint32_t LatchChannel;         // output compare channel of LatchTimer used by this strip
+    DMA_HandleTypeDef *DMA;        // resolved from the backend by WS2812B_Init
+    /* Writers change Back, the encoder reads Front, WS2812B_Commit swaps them.
+     * Double buffering is opt-in: with Frames[1] NULL both point at Frames[0], saving
+     * WS2812B_FRAME_BYTES(LED_Num) of RAM, and writes made while a frame is sent may show in it.
+     * Packed 4-bit palette indexes keep even LEDs in the low nibble. */
+    WS2812B_Pixel *Frames[2]; // caller supplied, WS2812B_FRAME_LEN(LED_Num) elements each
+    WS2812B_Pixel *Back;
+    WS2812B_Pixel *volatile Front;
+#if WS2812B_PALETTE_BITS
+    LED_Color Palette[WS2812B_PALETTE_SIZE]; // shared by both buffers
+    uint16_t PaletteUsed; // entries [0, PaletteUsed) were handed out, new colors reuse unused ones first
+    uint16_t PaletteUse[WS2812B_PALETTE_SIZE]; // LEDs of Back pointing at each entry
+    // Entries whose use dropped to 0 since the last commit, Front may still show them
+    uint8_t PaletteFreed[WS2812B_PALETTE_SIZE / 8];
+#endif
+    uint8_t Brightness;         // global scale applied on output, 255 = full
+    volatile uint8_t LUT_Stale; // Brightness changed, ColorLUT is rebuilt at the next frame start
+    uint8_t OutputLevel;        // brightness ColorLUT was built for, below Brightness when current limited
+    uint8_t ColorLUT[256];      // gamma x brightness, applied to every byte while encoding
+    uint16_t CurrentLimit_mA;   // supply budget of the strip, 0 = unlimited
+    uint32_t LevelBudget;       // CurrentLimit_mA as the largest FrontIntensity x level sum, 0 = unlimited
+    uint32_t IntensitySum;      // gamma corrected channel values summed over Back
+    uint32_t FrontIntensity;    // IntensitySum of the committed Front
+    uint16_t DirtyEnd; // LEDs [0, DirtyEnd) of Back changed since the last commit
+    uint16_t SendEnd;  // LEDs [0, SendEnd) of Front changed since the last refresh
+    uint16_t SendNum;  // number of LEDs sent by the current refresh
+    uint16_t NextSlot; // index of the next LED to be encoded into the DMA buffer
+    uint8_t SlotState[2];     // what each DMA slot holds, lets runs of one color skip the encoder
+    LED_Color SlotColor[2];   // output color encoded in the slot when SlotState is WS2812B_SlotColor
+    volatile uint8_t RefreshPending; // a refresh was requested while busy
+    uint32_t RequestedFrames;   // WS2812B_StartRefresh calls
+    uint32_t CoalescedFrames;   // requests merged into an already pending refresh
+    uint32_t TransmittedFrames; // frames sent and latched
+    uint32_t DMA_Buffer[WS2812B_DMA_BUFFER_WORDS];
 } WS2812B;
 
-WS2812B_Result WS2812B_SetLEDColor(WS2812B *strip, uint8_t led_index, LED_Color color);
+WS2812B_Result WS2812B_SetLEDColor(WS2812B *strip, uint16_t led_index, LED_Color color);
+WS2812B_Result WS2812B_FillLEDColor(WS2812B *strip, uint16_t first, uint16_t count, LED_Color color);
 WS2812B_Result WS2812B_SetAllLEDColor(WS2812B *strip, LED_Color color);
-WS2812B_Result WS2812B_LitTheLED(WS2812B *strip, uint8_t theLED, LED_Color color);
+WS2812B_Result WS2812B_LitTheLED(WS2812B *strip, uint16_t theLED, LED_Color color);
+LED_Color WS2812B_GetLEDColor(WS2812B *strip, uint16_t led_index);
+#if WS2812B_PALETTE_BITS
+WS2812B_Result WS2812B_SetLEDIndex(WS2812B *strip, uint16_t led_index, uint8_t palette_index);
+WS2812B_Result WS2812B_SetPaletteColor(WS2812B *strip, uint8_t palette_index, LED_Color color);
+#endif
+WS2812B_Result WS2812B_SetBrightness(WS2812B *strip, uint8_t brightness);
+WS2812B_Result WS2812B_SetCurrentLimit(WS2812B *strip, uint16_t limit_mA);
 WS2812B_Result WS2812B_Init(WS2812B *strip);
+WS2812B_Result WS2812B_Commit(WS2812B *strip);
 WS2812B_Result WS2812B_StartRefresh(WS2812B *strip);
+WS2812B_Result WS2812B_DMA_HalfIT(WS2812B *strip);
 WS2812B_Result WS2812B_DMA_IT(WS2812B *strip);
+WS2812B_Result WS2812B_LatchIT(WS2812B *strip);
+WS2812B *WS2812B_FindSPI(SPI_HandleTypeDef *hspi);
+WS2812B *WS2812B_FindTIM(TIM_HandleTypeDef *htim);
+WS2812B *WS2812B_FindLatch(TIM_HandleTypeDef *htim);
+uint8_t WS2812B_Hold(void);
+void WS2812B_Resume(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,178 @@
+#ifndef WS2812B_TIMING_H
+#define WS2812B_TIMING_H
+
+/* LED line timing, resolved at compile time from the clock tree.
+ * Nothing here depends on the HAL so spi.h / tim.c can include it. The configuration below can be
+ * overridden from the command line, the host tests (Tests/) build every line configuration they check. */
+
+// APB clock set up by SystemClock_Config (HSI / 2 * 5), SPI1 and the timers run from it
+#ifndef WS2812B_PCLK_HZ
+#define WS2812B_PCLK_HZ 20000000ULL
+#endif
+// Timer kernel clock, equal to PCLK while the APB prescaler is 1
+#define WS2812B_TIM_CLK_HZ WS2812B_PCLK_HZ
+
+/* SPI line encoding:
+ * 0: one SPI frame (9 to 16 bits) per LED bit, one halfword each in the DMA buffer
+ * 1: 8-bit frames, 3-bit symbols packed into 9 bytes per LED */
+#ifndef WS2812B_SPI_3BIT_SYMBOLS
+#define WS2812B_SPI_3BIT_SYMBOLS 0
+#endif
+// SPI1 baud rate prescaler, 2 to 256
+#ifndef WS2812B_SPI_PRESCALER
+#if WS2812B_SPI_3BIT_SYMBOLS
+#define WS2812B_SPI_PRESCALER 8
+#else
+#define WS2812B_SPI_PRESCALER 2
+#endif
+#endif
+
+// LED chip on the strips
+#define WS2812B_PROFILE_WS2812B     0
+#define WS2812B_PROFILE_WS2811      1 // 400kHz slow mode
+#define WS2812B_PROFILE_SK6812_RGBW 2
+#ifndef WS2812B_PROFILE
+#define WS2812B_PROFILE WS2812B_PROFILE_WS2812B
+#endif
+
+// Nominal high / low times in ns, every one must be met within +-TOL_NS
+#if WS2812B_PROFILE == WS2812B_PROFILE_WS2812B
+#define WS2812B_T0H_NS 400
+#define WS2812B_T1H_NS 800
+#define WS2812B_T0L_NS 850
+#define WS2812B_T1L_NS 450
+#define WS2812B_TOL_NS 150
+#define WS2812B_RESET_US 280 // newer parts need >280us, older >50us
+#define WS2812B_RGBW 0
+#elif WS2812B_PROFILE == WS2812B_PROFILE_WS2811
+#define WS2812B_T0H_NS 500
+#define WS2812B_T1H_NS 1200
+#define WS2812B_T0L_NS 2000
+#define WS2812B_T1L_NS 1300
+#define WS2812B_TOL_NS 150
+#define WS2812B_RESET_US 280
+#define WS2812B_RGBW 0
+#elif WS2812B_PROFILE == WS2812B_PROFILE_SK6812_RGBW
+#define WS2812B_T0H_NS 300
+#define WS2812B_T1H_NS 600
+#define WS2812B_T0L_NS 900
+#define WS2812B_T1L_NS 600
+#define WS2812B_TOL_NS 150
+#define WS2812B_RESET_US 80
+#define WS2812B_RGBW 1
+#else
+#error "Unknown WS2812B_PROFILE"
+#endif
+
+#define WS2812B_BIT_NS ((WS2812B_T0H_NS + WS2812B_T0L_NS + WS2812B_T1H_NS + WS2812B_T1L_NS) / 2)
+#define WS2812B_BITS_PER_LED (WS2812B_RGBW ? 32 : 24)
+
+#define WS2812B_DIV_ROUND(a, b) (((a) + (b) / 2) / (b))
+// A length in ps is within the tolerance around a nominal length in ns
+#define WS2812B_IN_TOL(ps, ns) \
+    ((ps) + WS2812B_TOL_NS * 1000ULL >= (ns) * 1000ULL && (ps) <= ((ns) + WS2812B_TOL_NS) * 1000ULL)
+
+/* SPI backend -------------------------------------------------------------*/
+
+#define WS2812B_SPI_CLK_PS ((WS2812B_SPI_PRESCALER * 1000000000000ULL) / WS2812B_PCLK_HZ)
+
+#if WS2812B_SPI_3BIT_SYMBOLS
+// Fixed 110 / 100 symbols, the SPI clock has to fit them
+#define WS2812B_SPI_SYMBOL_BITS 3
+#define WS2812B_SPI_T0H_BITS 1
+#define WS2812B_SPI_T1H_BITS 2
+#define WS2812B_SPI_FRAME_BITS 8
+#else
+#define WS2812B_SPI_SYMBOL_BITS WS2812B_DIV_ROUND(WS2812B_BIT_NS * 1000ULL, WS2812B_SPI_CLK_PS)
+#define WS2812B_SPI_T0H_BITS WS2812B_DIV_ROUND(WS2812B_T0H_NS * 1000ULL, WS2812B_SPI_CLK_PS)
+#define WS2812B_SPI_T1H_BITS WS2812B_DIV_ROUND(WS2812B_T1H_NS * 1000ULL, WS2812B_SPI_CLK_PS)
+#define WS2812B_SPI_FRAME_BITS WS2812B_SPI_SYMBOL_BITS
+#if WS2812B_SPI_SYMBOL_BITS > 16
+#error "SPI clock too fast for one frame per LED bit, raise WS2812B_SPI_PRESCALER"
+#endif
+#if WS2812B_SPI_SYMBOL_BITS < 9
+#error "SPI clock too slow for halfword frames, lower WS2812B_SPI_PRESCALER or use WS2812B_SPI_3BIT_SYMBOLS"
+#endif
+#endif
+
+#if !WS2812B_IN_TOL(WS2812B_SPI_T0H_BITS * WS2812B_SPI_CLK_PS, WS2812B_T0H_NS) || \
+    !WS2812B_IN_TOL(WS2812B_SPI_T1H_BITS * WS2812B_SPI_CLK_PS, WS2812B_T1H_NS) || \
+    !WS2812B_IN_TOL((WS2812B_SPI_SYMBOL_BITS - WS2812B_SPI_T0H_BITS) * WS2812B_SPI_CLK_PS, WS2812B_T0L_NS) || \
+    !WS2812B_IN_TOL((WS2812B_SPI_SYMBOL_BITS - WS2812B_SPI_T1H_BITS) * WS2812B_SPI_CLK_PS, WS2812B_T1L_NS)
+#error "LED timing cannot be met with this PCLK and WS2812B_SPI_PRESCALER"
+#endif
+
+// High bits first, the rest of the symbol low
+#define WS2812B_SPI_SYMBOL(high_bits) \
+    (((1U << (high_bits)) - 1) << (WS2812B_SPI_SYMBOL_BITS - (high_bits)))
+#define WS2812B_SPI_SYMBOL_0 WS2812B_SPI_SYMBOL(WS2812B_SPI_T0H_BITS)
+#define WS2812B_SPI_SYMBOL_1 WS2812B_SPI_SYMBOL(WS2812B_SPI_T1H_BITS)
+
+// SPI_DATASIZE_xBIT and SPI_BAUDRATEPRESCALER_x register encodings
+#define WS2812B_SPI_DATASIZE ((WS2812B_SPI_FRAME_BITS - 1U) << 8)
+#if WS2812B_SPI_PRESCALER == 2
+#define WS2812B_SPI_BAUDRATEPRESCALER (0U << 3)
+#elif WS2812B_SPI_PRESCALER == 4
+#define WS2812B_SPI_BAUDRATEPRESCALER (1U << 3)
+#elif WS2812B_SPI_PRESCALER == 8
+#define WS2812B_SPI_BAUDRATEPRESCALER (2U << 3)
+#elif WS2812B_SPI_PRESCALER == 16
+#define WS2812B_SPI_BAUDRATEPRESCALER (3U << 3)
+#elif WS2812B_SPI_PRESCALER == 32
+#define WS2812B_SPI_BAUDRATEPRESCALER (4U << 3)
+#elif WS2812B_SPI_PRESCALER == 64
+#define WS2812B_SPI_BAUDRATEPRESCALER (5U << 3)
+#elif WS2812B_SPI_PRESCALER == 128
+#define WS2812B_SPI_BAUDRATEPRESCALER (6U << 3)
+#elif WS2812B_SPI_PRESCALER == 256
+#define WS2812B_SPI_BAUDRATEPRESCALER (7U << 3)
+#else
+#error "WS2812B_SPI_PRESCALER must be a power of two from 2 to 256"
+#endif
+
+// Wire time of one LED and of a whole frame of n LEDs including the latch, for refresh rate budgets
+#define WS2812B_SPI_LED_NS ((WS2812B_BITS_PER_LED * WS2812B_SPI_SYMBOL_BITS * WS2812B_SPI_CLK_PS) / 1000ULL)
+#define WS2812B_SPI_FRAME_US(n) (((n) * WS2812B_SPI_LED_NS) / 1000ULL + WS2812B_RESET_US)
+
+// The latch interrupt comes once the zero slot behind the data has been read, two symbols before its end
+#define WS2812B_SPI_SLOT_LOW_US \
+    ((uint8_t)(((WS2812B_BITS_PER_LED - 2) * WS2812B_SPI_SYMBOL_BITS * WS2812B_SPI_CLK_PS) / 1000000ULL))
+
+/* TIM backend -------------------------------------------------------------*/
+
+// PWM period and compare values in timer ticks
+#define WS2812B_TIM_TICKS(ns) WS2812B_DIV_ROUND((ns) * WS2812B_TIM_CLK_HZ, 1000000000ULL)
+#define WS2812B_TIM_PERIOD WS2812B_TIM_TICKS(WS2812B_BIT_NS)
+#define WS2812B_TIM_T0H WS2812B_TIM_TICKS(WS2812B_T0H_NS)
+#define WS2812B_TIM_T1H WS2812B_TIM_TICKS(WS2812B_T1H_NS)
+#define WS2812B_TIM_TICK_PS (1000000000000ULL / WS2812B_TIM_CLK_HZ)
+
+#if WS2812B_TIM_T1H > 255
+#error "Compare values are sent as bytes, the timer clock is too fast"
+#endif
+#if !WS2812B_IN_TOL(WS2812B_TIM_T0H * WS2812B_TIM_TICK_PS, WS2812B_T0H_NS) || \
+    !WS2812B_IN_TOL(WS2812B_TIM_T1H * WS2812B_TIM_TICK_PS, WS2812B_T1H_NS) || \
+    !WS2812B_IN_TOL((WS2812B_TIM_PERIOD - WS2812B_TIM_T0H) * WS2812B_TIM_TICK_PS, WS2812B_T0L_NS) || \
+    !WS2812B_IN_TOL((WS2812B_TIM_PERIOD - WS2812B_TIM_T1H) * WS2812B_TIM_TICK_PS, WS2812B_T1L_NS)
+#error "LED timing cannot be met with this timer clock"
+#endif
+
+#define WS2812B_TIM_LED_NS ((WS2812B_BITS_PER_LED * WS2812B_TIM_PERIOD * WS2812B_TIM_TICK_PS) / 1000ULL)
+#define WS2812B_TIM_FRAME_US(n) (((n) * WS2812B_TIM_LED_NS) / 1000ULL + WS2812B_RESET_US)
+
+#define WS2812B_TIM_SLOT_LOW_US \
+    ((uint8_t)(((WS2812B_BITS_PER_LED - 2) * WS2812B_TIM_PERIOD * 1000000ULL) / WS2812B_TIM_CLK_HZ))
+
+/* Latch timer (TIM1) ------------------------------------------------------*/
+
+// TIM1 counts microseconds: the reset window is timed in us and its update is the effect tick
+#define WS2812B_LATCH_PRESCALER (WS2812B_TIM_CLK_HZ / 1000000ULL - 1)
+
+#if WS2812B_TIM_CLK_HZ % 1000000ULL != 0
+#error "TIM1 needs a whole MHz timer clock to count microseconds"
+#endif
+#if WS2812B_LATCH_PRESCALER > 0xFFFF
+#error "Timer clock too fast for a 1MHz TIM1"
+#endif
+
+#endif /* WS2812B_TIMING_H */
@@ -4,25 +4,62 @@
 #include "usart.h"
 #include "UnitCommute.h"
 #include "WS2812B_Driver.h"
+#include "LED_Effect.h"
+#include "LED_Animation.h"
+#include "LED_Highlight.h"
+#include "UC_Port.h"
 
-extern WS2812B ledStrip;
+extern LED_Effects ledEffects[WS2812B_MAX_STRIP_NUM];
+extern LED_Animation ledAnimation[WS2812B_MAX_STRIP_NUM];
+extern LED_Highlights ledHighlights[WS2812B_MAX_STRIP_NUM];
+
+void HAL_SPI_TxHalfCpltCallback(SPI_HandleTypeDef *hspi){
+    // WS2812B DMA first half sent, refill it (NULL strip is rejected by the driver)
+    WS2812B_DMA_HalfIT(WS2812B_FindSPI(hspi));
+}
 
-uint8_t Uart_ByteReceiveDirection = 0; // 0: not received, 1: received from UART1, 2: received from UART2
-uint8_t RxBuf;
 void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi){
-    if(hspi->Instance == SPI1){
-        // WS2812B DMA transmission complete callback
-        WS2812B_DMA_IT(&ledStrip);
-    }
+    // WS2812B DMA transmission complete callback
+    WS2812B_DMA_IT(WS2812B_FindSPI(hspi));
+}
+
+void HAL_TIM_PWM_PulseFinishedHalfCpltCallback(TIM_HandleTypeDef *htim){
+    // WS2812B timer backend, first half of the compare buffer sent
+    WS2812B_DMA_HalfIT(WS2812B_FindTIM(htim));
+}
+
+void HAL_TIM_PWM_PulseFinishedCallback(TIM_HandleTypeDef *htim){
+    // WS2812B timer backend, second half of the compare buffer sent
+    WS2812B_DMA_IT(WS2812B_FindTIM(htim));
 }
 
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart){
-    if(huart->Instance == USART1){
-        Uart_ByteReceiveDirection = 1;
-        HAL_UART_Receive_IT(huart, &RxBuf, 1);
-    }else if(huart->Instance == USART2){
-        // UART2 receive complete callback
-        Uart_ByteReceiveDirection = 2;
-        HAL_UART_Receive_IT(huart, &RxBuf, 1);
+void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef *htim){
+    // WS2812B reset window elapsed
+    WS2812B_LatchIT(WS2812B_FindLatch(htim));
+}
+
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim){
+    if(htim == &htim1){
+        // TIM1 update, effect, animation and highlight expiry tick
+        for(uint8_t i = 0; i < WS2812B_MAX_STRIP_NUM; i++){
+            LED_Effect_TickIT(&ledEffects[i]);
+            LED_Animation_TickIT(&ledAnimation[i]);
+            LED_Highlight_TickIT(&ledHighlights[i]);
+        }
     }
+}
+
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size){
+    // Chain port burst received (idle line, half or full ring)
+    UC_Port_RxEventIT(UC_Port_Find(huart), Size);
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart){
+    // Chain port transfer sent, start the next queued one
+    UC_Port_TxCpltIT(UC_Port_Find(huart));
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart){
+    // Transfer aborted by a UART error, restart it
+    UC_Port_ErrorIT(UC_Port_Find(huart));
 }
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include "LED_Animation.h"
+
+static const LED_Color LED_Animation_Off = {0, 0, 0};
+
+static uint32_t LED_Animation_SlotAddress(uint8_t slot){
+    return LED_ANIMATION_FLASH_BASE + (uint32_t)slot * LED_ANIMATION_SLOT_SIZE;
+}
+
+static const LED_AnimationHeader *LED_Animation_Slot(uint8_t slot){
+    return (const LED_AnimationHeader *)(uintptr_t)LED_Animation_SlotAddress(slot);
+}
+
+static const LED_Keyframe *LED_Animation_Keys(const LED_AnimationHeader *header){
+    return (const LED_Keyframe *)(header + 1);
+}
+
+static uint8_t LED_Animation_SameTrack(const LED_Keyframe *a, const LED_Keyframe *b){
+    return a->First == b->First && a->Count == b->Count;
+}
+
+/* Upload ------------------------------------------------------------------*/
+
+WS2812B_Result LED_Animation_Init(LED_Animation *anim, LED_Layers *layers){
+    if(anim == NULL || layers == NULL){
+        return WS2812B_Error;
+    }
+    anim->Layers = layers;
+    anim->Playing = NULL;
+    anim->Time_ms = 0;
+    anim->PendingTicks = 0;
+    anim->UploadSlot = LED_ANIMATION_SLOT_NUM;
+    anim->UploadKeys = 0;
+    return WS2812B_OK;
+}
+
+// Erase a slot to receive a new animation, replacing the one stored there
+WS2812B_Result LED_Animation_BeginUpload(LED_Animation *anim, uint8_t slot){
+    if(anim == NULL || slot >= LED_ANIMATION_SLOT_NUM){
+        return WS2812B_Error;
+    }
+    LED_Animation_StopSlot(anim, slot);
+    HAL_StatusTypeDef status = LED_Flash_ErasePage(LED_Animation_SlotAddress(slot));
+    anim->UploadSlot = (status == HAL_OK) ? slot : LED_ANIMATION_SLOT_NUM;
+    anim->UploadKeys = 0;
+    return (status == HAL_OK) ? WS2812B_OK : WS2812B_Error;
+}
+
+WS2812B_Result LED_Animation_AddKeyframe(LED_Animation *anim, const LED_Keyframe *key){
+    if(anim == NULL || key == NULL || anim->UploadSlot >= LED_ANIMATION_SLOT_NUM){
+        return WS2812B_Error;
+    }
+    if(anim->UploadKeys >= LED_ANIMATION_MAX_KEYS || key->Count == 0 ||
+       key->First + key->Count > anim->Layers->Strip->LED_Num){
+        return WS2812B_Error;
+    }
+    const LED_AnimationHeader *header = LED_Animation_Slot(anim->UploadSlot);
+    if(anim->UploadKeys > 0){
+        // Interpolation divides by the gap to the next keyframe of the track
+        const LED_Keyframe *prev = &LED_Animation_Keys(header)[anim->UploadKeys - 1];
+        if(LED_Animation_SameTrack(prev, key) && key->Time_ms <= prev->Time_ms){
+            return WS2812B_Error;
+        }
+    }
+    uint32_t address = LED_Animation_SlotAddress(anim->UploadSlot) + sizeof(LED_AnimationHeader) +
+                       anim->UploadKeys * sizeof(LED_Keyframe);
+    if(LED_Flash_Program(address, key, sizeof(LED_Keyframe)) != HAL_OK){
+        anim->UploadSlot = LED_ANIMATION_SLOT_NUM;
+        return WS2812B_Error;
+    }
+    anim->UploadKeys++;
+    return WS2812B_OK;
+}
+
+// Write the header, which makes the slot playable
+WS2812B_Result LED_Animation_EndUpload(LED_Animation *anim, uint16_t duration_ms, uint16_t flags){
+    if(anim == NULL || anim->UploadSlot >= LED_ANIMATION_SLOT_NUM || anim->UploadKeys == 0 || duration_ms == 0){
+        return WS2812B_Error;
+    }
+    LED_AnimationHeader header = {
+        .Magic = LED_ANIMATION_MAGIC,
+        .KeyNum = anim->UploadKeys,
+        .Duration_ms = duration_ms,
+        .Flags = flags
+    };
+    HAL_StatusTypeDef status =
+        LED_Flash_Program(LED_Animation_SlotAddress(anim->UploadSlot), &header, sizeof(header));
+    anim->UploadSlot = LED_ANIMATION_SLOT_NUM;
+    return (status == HAL_OK) ? WS2812B_OK : WS2812B_Error;
+}
+
+/* Playback ----------------------------------------------------------------*/
+
+// a + (b - a) * frac, frac in Q0.16
+static inline uint8_t LED_Animation_Lerp(uint8_t a, uint8_t b, uint32_t frac){
+    return (uint8_t)(a + (((int32_t)b - a) * (int32_t)frac >> 16));
+}
+
+// Put every track at its color for the given time, tracks not started yet are left alone
+static void LED_Animation_Render(LED_Animation *anim, uint32_t time){
+    const LED_AnimationHeader *header = anim->Playing;
+    const LED_Keyframe *keys = LED_Animation_Keys(header);
+
+    for(uint16_t i = 0; i < header->KeyNum; i++){
+        const LED_Keyframe *key = &keys[i];
+        const LED_Keyframe *next = (i + 1 < header->KeyNum && LED_Animation_SameTrack(key, &keys[i + 1])) ? &keys[i + 1] : NULL;
+        // Only the last keyframe of the track at or before the time is drawn
+        if(time < key->Time_ms || (next != NULL && time >= next->Time_ms)){
+            continue;
+        }
+        LED_Color color = {.G = key->G, .R = key->R, .B = key->B};
+        if(next != NULL){
+            uint32_t frac = ((time - key->Time_ms) << 16) / (next->Time_ms - key->Time_ms);
+            color.G = LED_Animation_Lerp(key->G, next->G, frac);
+            color.R = LED_Animation_Lerp(key->R, next->R, frac);
+            color.B = LED_Animation_Lerp(key->B, next->B, frac);
+        }
+        LED_Layer_Draw(anim->Layers, key->First, key->Count, color);
+    }
+}
+
+WS2812B_Result LED_Animation_Play(LED_Animation *anim, uint8_t slot){
+    if(anim == NULL || slot >= LED_ANIMATION_SLOT_NUM || slot == anim->UploadSlot){
+        return WS2812B_Error;
+    }
+    const LED_AnimationHeader *header = LED_Animation_Slot(slot);
+    if(header->Magic != LED_ANIMATION_MAGIC || header->KeyNum == 0 || header->KeyNum > LED_ANIMATION_MAX_KEYS){
+        return WS2812B_Error;
+    }
+    if(anim->Playing != NULL){
+        LED_Animation_Stop(anim);
+    }
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    anim->PendingTicks = 0;
+    __set_PRIMASK(primask);
+    anim->Time_ms = 0;
+    anim->Playing = header;
+    LED_Animation_Render(anim, 0);
+    return WS2812B_OK;
+}
+
+// Stop playback and switch off every range the animation drives
+void LED_Animation_Stop(LED_Animation *anim){
+    const LED_AnimationHeader *header = anim->Playing;
+    if(header == NULL){
+        return;
+    }
+    anim->Playing = NULL;
+    const LED_Keyframe *keys = LED_Animation_Keys(header);
+    for(uint16_t i = 0; i < header->KeyNum; i++){
+        LED_Layer_Draw(anim->Layers, keys[i].First, keys[i].Count, LED_Animation_Off);
+    }
+}
+
+// Stop playback if it runs the animation of the slot, before the slot is erased
+void LED_Animation_StopSlot(LED_Animation *anim, uint8_t slot){
+    if(slot < LED_ANIMATION_SLOT_NUM && anim->Playing == LED_Animation_Slot(slot)){
+        LED_Animation_Stop(anim);
+    }
+}
+
+// Timer update interrupt, only counts so the rendering stays out of interrupt context
+void LED_Animation_TickIT(LED_Animation *anim){
+    if(anim->Playing != NULL && anim->PendingTicks < UINT16_MAX){
+        anim->PendingTicks++;
+    }
+}
+
+void LED_Animation_Process(LED_Animation *anim){
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint16_t ticks = anim->PendingTicks;
+    anim->PendingTicks = 0;
+    __set_PRIMASK(primask);
+    if(ticks == 0 || anim->Playing == NULL){
+        return;
+    }
+
+    const LED_AnimationHeader *header = anim->Playing;
+    anim->Time_ms += (uint32_t)ticks * LED_ANIMATION_TICK_MS;
+    uint8_t finished = 0;
+    if(anim->Time_ms >= header->Duration_ms){
+        if(header->Flags & LED_ANIMATION_LOOP){
+            anim->Time_ms %= header->Duration_ms;
+        }else{
+            // Hold the final state
+            anim->Time_ms = header->Duration_ms;
+            finished = 1;
+        }
+    }
+    LED_Animation_Render(anim, anim->Time_ms);
+    if(finished){
+        anim->Playing = NULL;
+    }
+}
@@ -0,0 +1,151 @@
+#include "LED_Effect.h"
+
+static const LED_Color LED_Effect_Off = {0, 0, 0};
+
+static inline uint8_t LED_Effect_Scale(uint8_t value, uint8_t level){
+    return ((uint16_t)value * level + 255) >> 8;
+}
+
+static int8_t LED_Effect_Find(LED_Effects *fx, uint16_t first){
+    for(uint8_t i=0; i<LED_EFFECT_MAX_NUM; i++){
+        if(fx->Type[i] != LED_Effect_None && fx->First[i] == first){
+            return i;
+        }
+    }
+    return -1;
+}
+
+WS2812B_Result LED_Effect_Init(LED_Effects *fx, LED_Layers *layers){
+    if(fx == NULL || layers == NULL){
+        return WS2812B_Error;
+    }
+    fx->Layers = layers;
+    for(uint8_t i=0; i<LED_EFFECT_MAX_NUM; i++){
+        fx->Type[i] = LED_Effect_None;
+    }
+    fx->PendingTicks = 0;
+    return WS2812B_OK;
+}
+
+WS2812B_Result LED_Effect_Start(LED_Effects *fx, LED_EffectType type, uint16_t first, uint16_t count,
+                                LED_Color color, uint16_t period_ms){
+    if(fx == NULL || fx->Layers == NULL || type == LED_Effect_None || type > LED_Effect_Chase){
+        return WS2812B_Error;
+    }
+    if(count == 0 || first + count > fx->Layers->Strip->LED_Num){
+        return WS2812B_Error;
+    }
+    uint16_t periodTicks = period_ms / LED_EFFECT_TICK_MS;
+    if(periodTicks < 2){
+        return WS2812B_Error;
+    }
+
+    // Restart an effect already running on the same range, else take a free entry
+    int8_t idx = LED_Effect_Find(fx, first);
+    if(idx < 0){
+        for(uint8_t i=0; i<LED_EFFECT_MAX_NUM; i++){
+            if(fx->Type[i] == LED_Effect_None){
+                idx = i;
+                break;
+            }
+        }
+    }
+    if(idx < 0){
+        return WS2812B_Error;
+    }
+    fx->First[idx] = first;
+    fx->Count[idx] = count;
+    fx->Color[idx] = color;
+    fx->Phase[idx] = 0;
+    fx->Step[idx] = (uint16_t)(65536UL / periodTicks);
+    fx->Type[idx] = type;
+    return WS2812B_OK;
+}
+
+WS2812B_Result LED_Effect_Stop(LED_Effects *fx, uint16_t first){
+    if(fx == NULL){
+        return WS2812B_Error;
+    }
+    int8_t idx = LED_Effect_Find(fx, first);
+    if(idx < 0){
+        return WS2812B_Error;
+    }
+    fx->Type[idx] = LED_Effect_None;
+    LED_Layer_Draw(fx->Layers, fx->First[idx], fx->Count[idx], LED_Effect_Off);
+    return WS2812B_OK;
+}
+
+void LED_Effect_StopAll(LED_Effects *fx){
+    for(uint8_t i=0; i<LED_EFFECT_MAX_NUM; i++){
+        if(fx->Type[i] != LED_Effect_None){
+            fx->Type[i] = LED_Effect_None;
+            LED_Layer_Draw(fx->Layers, fx->First[i], fx->Count[i], LED_Effect_Off);
+        }
+    }
+}
+
+// Timer update interrupt, only counts so the rendering stays out of interrupt context
+void LED_Effect_TickIT(LED_Effects *fx){
+    if(fx->PendingTicks < UINT16_MAX){
+        fx->PendingTicks++;
+    }
+}
+
+static void LED_Effect_Render(LED_Effects *fx, uint8_t idx){
+    LED_Layers *layers = fx->Layers;
+    uint16_t phase = fx->Phase[idx];
+    LED_Color color = fx->Color[idx];
+
+    switch(fx->Type[idx]){
+    case LED_Effect_Blink:
+        LED_Layer_Draw(layers, fx->First[idx], fx->Count[idx], (phase < 0x8000) ? color : LED_Effect_Off);
+        break;
+
+    case LED_Effect_Breathe: {
+        // Triangle wave, squared so the fade looks linear to the eye
+        uint8_t tri = (phase < 0x8000) ? (phase >> 7) : ((0xFFFF - phase) >> 7);
+        uint8_t level = ((uint16_t)tri * tri) >> 8;
+        LED_Color dimmed = {
+            LED_Effect_Scale(color.G, level),
+            LED_Effect_Scale(color.R, level),
+            LED_Effect_Scale(color.B, level),
+#if WS2812B_RGBW
+            LED_Effect_Scale(color.W, level)
+#endif
+        };
+        LED_Layer_Draw(layers, fx->First[idx], fx->Count[idx], dimmed);
+        break;
+    }
+
+    case LED_Effect_Chase: {
+        uint16_t lit = ((uint32_t)phase * fx->Count[idx]) >> 16;
+        for(uint16_t i=0; i<fx->Count[idx]; i++){
+            LED_Layer_Draw(layers, fx->First[idx] + i, 1, (i == lit) ? color : LED_Effect_Off);
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+// Main loop side: advance by the ticks elapsed, LED_Layer_Process shows what changed
+void LED_Effect_Process(LED_Effects *fx){
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint16_t ticks = fx->PendingTicks;
+    fx->PendingTicks = 0;
+    __set_PRIMASK(primask);
+    if(ticks == 0){
+        return;
+    }
+
+    for(uint8_t i=0; i<LED_EFFECT_MAX_NUM; i++){
+        if(fx->Type[i] == LED_Effect_None){
+            continue;
+        }
+        fx->Phase[i] += (uint16_t)(fx->Step[i] * ticks);
+        LED_Effect_Render(fx, i);
+    }
+}
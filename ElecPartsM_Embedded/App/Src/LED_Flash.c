@@ -0,0 +1,43 @@
+#include "LED_Flash.h"
+#include "WS2812B_Driver.h"
+
+/* The CPU stalls on flash fetches while a page is erased or a halfword programmed, no interrupt
+ * handler runs meanwhile. A late refill interrupt would corrupt the frame on the wire, so wait for
+ * the strips to stop streaming and hold new frames until the flash is locked again.
+ * USART2 keeps receiving through its circular DMA. USART1 receives by interrupt and can overrun
+ * during a page erase (20-40ms), between programmed halfwords its interrupt gets through. */
+static void LED_Flash_Unlock(void){
+    while(!WS2812B_Hold()){
+    }
+    HAL_FLASH_Unlock();
+}
+
+static void LED_Flash_Lock(void){
+    HAL_FLASH_Lock();
+    WS2812B_Resume();
+}
+
+HAL_StatusTypeDef LED_Flash_ErasePage(uint32_t address){
+    FLASH_EraseInitTypeDef erase = {
+        .TypeErase = FLASH_TYPEERASE_PAGES,
+        .PageAddress = address,
+        .NbPages = 1
+    };
+    uint32_t pageError;
+    LED_Flash_Unlock();
+    HAL_StatusTypeDef status = HAL_FLASHEx_Erase(&erase, &pageError);
+    LED_Flash_Lock();
+    return status;
+}
+
+// Program halfword aligned data into erased flash
+HAL_StatusTypeDef LED_Flash_Program(uint32_t address, const void *data, uint16_t bytes){
+    const uint16_t *halfwords = data;
+    HAL_StatusTypeDef status = HAL_OK;
+    LED_Flash_Unlock();
+    for(uint16_t i = 0; i < bytes / 2 && status == HAL_OK; i++){
+        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, address + 2 * i, halfwords[i]);
+    }
+    LED_Flash_Lock();
+    return status;
+}
@@ -0,0 +1,159 @@
+#include "LED_Highlight.h"
+
+static const LED_Color LED_Highlight_Off = {0, 0, 0};
+
+/* Timing wheel ------------------------------------------------------------*/
+
+// Put an entry into the slot of its expiry, on the lowest level whose span still reaches it
+static void LED_Highlight_Link(LED_Highlights *hl, uint8_t idx){
+    uint32_t delta = hl->Expiry[idx] - hl->Now;
+    uint8_t level = 0;
+    while(level < LED_HIGHLIGHT_WHEEL_LEVELS - 1 && delta >> ((level + 1) * LED_HIGHLIGHT_WHEEL_BITS)){
+        level++;
+    }
+    uint8_t slot = (hl->Expiry[idx] >> (level * LED_HIGHLIGHT_WHEEL_BITS)) & (LED_HIGHLIGHT_WHEEL_SLOTS - 1);
+    uint8_t head = level * LED_HIGHLIGHT_WHEEL_SLOTS + slot;
+
+    hl->Next[idx] = hl->Wheel[head];
+    hl->Prev[idx] = LED_HIGHLIGHT_NONE;
+    if(hl->Wheel[head] != LED_HIGHLIGHT_NONE){
+        hl->Prev[hl->Wheel[head]] = idx;
+    }
+    hl->Wheel[head] = idx;
+    hl->Where[idx] = head;
+}
+
+static void LED_Highlight_Unlink(LED_Highlights *hl, uint8_t idx){
+    if(hl->Where[idx] == LED_HIGHLIGHT_NONE){
+        return;
+    }
+    if(hl->Prev[idx] != LED_HIGHLIGHT_NONE){
+        hl->Next[hl->Prev[idx]] = hl->Next[idx];
+    }else{
+        hl->Wheel[hl->Where[idx]] = hl->Next[idx];
+    }
+    if(hl->Next[idx] != LED_HIGHLIGHT_NONE){
+        hl->Prev[hl->Next[idx]] = hl->Prev[idx];
+    }
+    hl->Where[idx] = LED_HIGHLIGHT_NONE;
+}
+
+// Detach a whole slot list and return its first entry
+static uint8_t LED_Highlight_TakeSlot(LED_Highlights *hl, uint8_t level, uint8_t slot){
+    uint8_t head = level * LED_HIGHLIGHT_WHEEL_SLOTS + slot;
+    uint8_t idx = hl->Wheel[head];
+    hl->Wheel[head] = LED_HIGHLIGHT_NONE;
+    return idx;
+}
+
+// Process tick Now: move the entries now in reach of a lower level down, then expire slot Now of level 0
+static void LED_Highlight_Advance(LED_Highlights *hl){
+    uint32_t now = hl->Now;
+    // Higher levels first, their entries may land in the level 1 slot cascaded right after
+    for(uint8_t level = LED_HIGHLIGHT_WHEEL_LEVELS - 1; level > 0; level--){
+        uint8_t shift = level * LED_HIGHLIGHT_WHEEL_BITS;
+        if(now & ((1UL << shift) - 1)){
+            continue;
+        }
+        uint8_t idx = LED_Highlight_TakeSlot(hl, level, (now >> shift) & (LED_HIGHLIGHT_WHEEL_SLOTS - 1));
+        while(idx != LED_HIGHLIGHT_NONE){
+            uint8_t next = hl->Next[idx];
+            LED_Highlight_Link(hl, idx);
+            idx = next;
+        }
+    }
+
+    uint8_t idx = LED_Highlight_TakeSlot(hl, 0, now & (LED_HIGHLIGHT_WHEEL_SLOTS - 1));
+    while(idx != LED_HIGHLIGHT_NONE){
+        uint8_t next = hl->Next[idx];
+        hl->Where[idx] = LED_HIGHLIGHT_NONE;
+        LED_Layer_Draw(hl->Layers, hl->First[idx], hl->Count[idx], LED_Highlight_Off);
+        hl->Count[idx] = 0;
+        idx = next;
+    }
+    hl->Now = now + 1;
+}
+
+/* Highlights --------------------------------------------------------------*/
+
+WS2812B_Result LED_Highlight_Init(LED_Highlights *hl, LED_Layers *layers){
+    if(hl == NULL || layers == NULL){
+        return WS2812B_Error;
+    }
+    hl->Layers = layers;
+    for(uint8_t i = 0; i < LED_HIGHLIGHT_WHEEL_LEVELS * LED_HIGHLIGHT_WHEEL_SLOTS; i++){
+        hl->Wheel[i] = LED_HIGHLIGHT_NONE;
+    }
+    for(uint8_t i = 0; i < LED_HIGHLIGHT_MAX_NUM; i++){
+        hl->Count[i] = 0;
+        hl->Where[i] = LED_HIGHLIGHT_NONE;
+    }
+    hl->Now = 0;
+    hl->PendingTicks = 0;
+    return WS2812B_OK;
+}
+
+/* Light a range, switched off again after timeout_ms unless it is 0.
+ * Highlights overlapping the range are dropped and their LEDs switched off first, timed or not.
+ * Every lit highlight takes an entry, switching a range off without a timeout takes none. */
+WS2812B_Result LED_Highlight_Set(LED_Highlights *hl, uint16_t first, uint16_t count, LED_Color color,
+                                 uint32_t timeout_ms){
+    if(hl == NULL || hl->Layers == NULL || count == 0 || first + count > hl->Layers->Strip->LED_Num){
+        return WS2812B_Error;
+    }
+    // An entry to reuse: a free one or one this highlight replaces
+    uint8_t idx = LED_HIGHLIGHT_NONE;
+    for(uint8_t i = 0; i < LED_HIGHLIGHT_MAX_NUM && idx == LED_HIGHLIGHT_NONE; i++){
+        if(hl->Count[i] == 0 || (hl->First[i] < first + count && first < hl->First[i] + hl->Count[i])){
+            idx = i;
+        }
+    }
+    uint8_t off = (timeout_ms == 0 && WS2812B_SameColor(color, LED_Highlight_Off));
+    if(!off && idx == LED_HIGHLIGHT_NONE){
+        return WS2812B_Error;
+    }
+
+    for(uint8_t i = 0; i < LED_HIGHLIGHT_MAX_NUM; i++){
+        if(hl->Count[i] != 0 && hl->First[i] < first + count && first < hl->First[i] + hl->Count[i]){
+            LED_Highlight_Unlink(hl, i);
+            LED_Layer_Draw(hl->Layers, hl->First[i], hl->Count[i], LED_Highlight_Off);
+            hl->Count[i] = 0;
+        }
+    }
+    LED_Layer_Draw(hl->Layers, first, count, color);
+
+    if(!off){
+        hl->First[idx] = first;
+        hl->Count[idx] = count;
+    }
+    // Untimed entries stay out of the wheel, only a later overlapping highlight drops them
+    if(timeout_ms != 0){
+        uint32_t ticks = (timeout_ms + LED_HIGHLIGHT_TICK_MS - 1) / LED_HIGHLIGHT_TICK_MS;
+        if(ticks > LED_HIGHLIGHT_MAX_TICKS){
+            ticks = LED_HIGHLIGHT_MAX_TICKS;
+        }
+        hl->Expiry[idx] = hl->Now + ticks - 1;
+        LED_Highlight_Link(hl, idx);
+    }
+    return WS2812B_OK;
+}
+
+// Timer update interrupt, only counts so the expiry work stays out of interrupt context
+void LED_Highlight_TickIT(LED_Highlights *hl){
+    if(hl->PendingTicks < UINT16_MAX){
+        hl->PendingTicks++;
+    }
+}
+
+// Main loop side: process the ticks elapsed, LED_Layer_Process shows everything that expired in them
+void LED_Highlight_Process(LED_Highlights *hl){
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint16_t ticks = hl->PendingTicks;
+    hl->PendingTicks = 0;
+    __set_PRIMASK(primask);
+
+    while(ticks--){
+        LED_Highlight_Advance(hl);
+    }
+}
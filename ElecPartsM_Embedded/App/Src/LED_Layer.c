@@ -0,0 +1,201 @@
+#include "LED_Layer.h"
+#include <string.h>
+
+static inline uint8_t LED_Layer_GetMask(LED_Layers *layers, uint16_t led){
+    return (layers->Mask[led >> 1] >> ((led & 1) * 4)) & 0x0F;
+}
+
+static inline void LED_Layer_SetMask(LED_Layers *layers, uint16_t led, uint8_t mask){
+    uint8_t shift = (led & 1) * 4;
+    layers->Mask[led >> 1] = (layers->Mask[led >> 1] & ~(0x0F << shift)) | (mask << shift);
+}
+
+static inline uint8_t LED_Layer_AddChannel(uint8_t a, uint8_t b){
+    uint16_t sum = a + b;
+    return (sum > 255) ? 255 : sum;
+}
+
+// Color of the layer entry covering the LED, the mask says one does
+static LED_Color LED_Layer_EntryColor(LED_Layers *layers, uint8_t layer, uint16_t led){
+    for(uint8_t e = 0; e < LED_LAYER_MAX_ENTRIES; e++){
+        uint16_t first = layers->First[layer][e];
+        if(layers->Count[layer][e] != 0 && led >= first && led < first + layers->Count[layer][e]){
+            return layers->Color[layer][e];
+        }
+    }
+    return (LED_Color){0};
+}
+
+// Color of one LED with the layers covering it laid over its base color
+static LED_Color LED_Layer_Blend(LED_Layers *layers, uint16_t led){
+    uint8_t mask = LED_Layer_GetMask(layers, led);
+    // Nothing below the highest opaque layer covering the LED shows
+    int8_t base = LED_LAYER_MAX_NUM - 1;
+    while(base > 0 && !(((mask >> base) & 1) && layers->Mode[base] == LED_Layer_Opaque)){
+        base--;
+    }
+    LED_Color color = layers->Base[led];
+    for(uint8_t layer = base; layer < LED_LAYER_MAX_NUM; layer++){
+        if(!((mask >> layer) & 1)){
+            continue;
+        }
+        LED_Color c = LED_Layer_EntryColor(layers, layer, led);
+        if(layers->Mode[layer] == LED_Layer_Opaque){
+            color = c;
+        }else{
+            color.G = LED_Layer_AddChannel(color.G, c.G);
+            color.R = LED_Layer_AddChannel(color.R, c.R);
+            color.B = LED_Layer_AddChannel(color.B, c.B);
+#if WS2812B_RGBW
+            color.W = LED_Layer_AddChannel(color.W, c.W);
+#endif
+        }
+    }
+    return color;
+}
+
+// Show one LED as the layers make it, report whether the strip content changed
+static uint8_t LED_Layer_Composite(LED_Layers *layers, uint16_t led){
+    LED_Color color = LED_Layer_Blend(layers, led);
+    if(WS2812B_SameColor(WS2812B_GetLEDColor(layers->Strip, led), color)){
+        return 0;
+    }
+    return WS2812B_SetLEDColor(layers->Strip, led, color) == WS2812B_OK;
+}
+
+// Widen the range LED_Layer_Process composites to [first, end)
+static void LED_Layer_MarkDirty(LED_Layers *layers, uint16_t first, uint16_t end){
+    if(first >= end){
+        return;
+    }
+    if(first < layers->DirtyFirst){
+        layers->DirtyFirst = first;
+    }
+    if(end > layers->DirtyEnd){
+        layers->DirtyEnd = end;
+    }
+}
+
+// Drop the layer entries overlapping a range, the LEDs they covered show the layers below again
+static void LED_Layer_Remove(LED_Layers *layers, uint8_t layer, uint16_t first, uint16_t count){
+    for(uint8_t e = 0; e < LED_LAYER_MAX_ENTRIES; e++){
+        uint16_t entryFirst = layers->First[layer][e];
+        uint8_t entryCount = layers->Count[layer][e];
+        if(entryCount == 0 || entryFirst >= first + count || first >= entryFirst + entryCount){
+            continue;
+        }
+        layers->Count[layer][e] = 0;
+        for(uint16_t led = entryFirst; led < entryFirst + entryCount; led++){
+            LED_Layer_SetMask(layers, led, LED_Layer_GetMask(layers, led) & ~(1 << layer));
+        }
+        LED_Layer_MarkDirty(layers, entryFirst, entryFirst + entryCount);
+    }
+}
+
+WS2812B_Result LED_Layer_Init(LED_Layers *layers, WS2812B *strip, LED_Color *base){
+    if(layers == NULL || strip == NULL || base == NULL){
+        return WS2812B_Error;
+    }
+    layers->Strip = strip;
+    layers->Base = base;
+    // Start from what the strip shows, nothing to composite yet
+    for(uint16_t led = 0; led < strip->LED_Num; led++){
+        base[led] = WS2812B_GetLEDColor(strip, led);
+    }
+    layers->DirtyFirst = strip->LED_Num;
+    layers->DirtyEnd = 0;
+    memset(layers->Mode, LED_Layer_Opaque, sizeof(layers->Mode));
+    memset(layers->Count, 0, sizeof(layers->Count));
+    memset(layers->Mask, 0, sizeof(layers->Mask));
+    layers->CommitPending = 0;
+    return WS2812B_OK;
+}
+
+WS2812B_Result LED_Layer_SetMode(LED_Layers *layers, uint8_t layer, LED_LayerMode mode){
+    if(layers == NULL || layer >= LED_LAYER_MAX_NUM || mode > LED_Layer_Add){
+        return WS2812B_Error;
+    }
+    layers->Mode[layer] = mode;
+    for(uint8_t e = 0; e < LED_LAYER_MAX_ENTRIES; e++){
+        if(layers->Count[layer][e] != 0){
+            LED_Layer_MarkDirty(layers, layers->First[layer][e], layers->First[layer][e] + layers->Count[layer][e]);
+        }
+    }
+    return WS2812B_OK;
+}
+
+// Color a range on one layer, replacing whatever the layer had on LEDs of the range
+WS2812B_Result LED_Layer_Set(LED_Layers *layers, uint8_t layer, uint16_t first, uint16_t count, LED_Color color){
+    if(layers == NULL || layer >= LED_LAYER_MAX_NUM || count == 0 || count > UINT8_MAX ||
+       first + count > layers->Strip->LED_Num){
+        return WS2812B_Error;
+    }
+    // Find the entry before changing anything, the entries the range replaces are free by then
+    int8_t idx = -1;
+    for(uint8_t e = 0; e < LED_LAYER_MAX_ENTRIES && idx < 0; e++){
+        uint16_t entryFirst = layers->First[layer][e];
+        uint8_t entryCount = layers->Count[layer][e];
+        if(entryCount == 0 || (entryFirst < first + count && first < entryFirst + entryCount)){
+            idx = e;
+        }
+    }
+    if(idx < 0){
+        return WS2812B_Error;
+    }
+    LED_Layer_Remove(layers, layer, first, count);
+    layers->First[layer][idx] = first;
+    layers->Count[layer][idx] = count;
+    layers->Color[layer][idx] = color;
+    for(uint16_t led = first; led < first + count; led++){
+        LED_Layer_SetMask(layers, led, LED_Layer_GetMask(layers, led) | (1 << layer));
+    }
+    LED_Layer_MarkDirty(layers, first, first + count);
+    return WS2812B_OK;
+}
+
+// Take the layer ranges overlapping [first, first + count) off whole, the layers below show through again
+WS2812B_Result LED_Layer_Clear(LED_Layers *layers, uint8_t layer, uint16_t first, uint16_t count){
+    if(layers == NULL || layer >= LED_LAYER_MAX_NUM){
+        return WS2812B_Error;
+    }
+    LED_Layer_Remove(layers, layer, first, count);
+    return WS2812B_OK;
+}
+
+WS2812B_Result LED_Layer_ClearAll(LED_Layers *layers, uint8_t layer){
+    return LED_Layer_Clear(layers, layer, 0, WS2812B_MAX_LED_NUM);
+}
+
+/* Draw beneath the layers: color a range of Base, shown where no opaque layer covers it.
+ * LEDs already holding the color at either end of the range stay out of the dirty range. */
+WS2812B_Result LED_Layer_Draw(LED_Layers *layers, uint16_t first, uint16_t count, LED_Color color){
+    if(layers == NULL || count == 0 || first + count > layers->Strip->LED_Num){
+        return WS2812B_Error;
+    }
+    uint16_t end = first + count;
+    while(first < end && WS2812B_SameColor(layers->Base[first], color)){
+        first++;
+    }
+    while(end > first && WS2812B_SameColor(layers->Base[end - 1], color)){
+        end--;
+    }
+    for(uint16_t led = first; led < end; led++){
+        layers->Base[led] = color;
+    }
+    LED_Layer_MarkDirty(layers, first, end);
+    return WS2812B_OK;
+}
+
+/* Main loop side, after the modules drawing into Base: composite the dirty range and commit
+ * the strip once. Retries a commit the strip refused while it was sending. */
+void LED_Layer_Process(LED_Layers *layers){
+    uint8_t changed = 0;
+    for(uint16_t led = layers->DirtyFirst; led < layers->DirtyEnd; led++){
+        changed |= LED_Layer_Composite(layers, led);
+    }
+    layers->DirtyFirst = layers->Strip->LED_Num;
+    layers->DirtyEnd = 0;
+    if(changed || layers->CommitPending){
+        layers->CommitPending = (WS2812B_Commit(layers->Strip) == WS2812B_Busy);
+    }
+}
@@ -0,0 +1,43 @@
+#include "LED_SlotTable.h"
+
+#define LED_SlotTable ((const LED_SlotRange *)(uintptr_t)LED_FLASH_SLOT_TABLE)
+
+WS2812B_Result LED_SlotTable_Erase(void){
+    return (LED_Flash_ErasePage(LED_FLASH_SLOT_TABLE) == HAL_OK) ? WS2812B_OK : WS2812B_Error;
+}
+
+// A uint8_t slot always lies in the table, see LED_SLOT_MAX_NUM
+WS2812B_Result LED_SlotTable_Map(uint8_t slot, uint16_t first, uint16_t count){
+    if(count == 0 || first + count > WS2812B_MAX_LED_NUM){
+        return WS2812B_Error;
+    }
+    // Already programmed since the last erase
+    if(LED_SlotTable[slot].First != LED_SLOT_UNMAPPED){
+        return WS2812B_Error;
+    }
+    LED_SlotRange range = {first, count};
+    uint32_t address = LED_FLASH_SLOT_TABLE + slot * sizeof(LED_SlotRange);
+    return (LED_Flash_Program(address, &range, sizeof(range)) == HAL_OK) ? WS2812B_OK : WS2812B_Error;
+}
+
+WS2812B_Result LED_SlotTable_Get(uint8_t slot, uint16_t *first, uint16_t *count){
+    if(LED_SlotTable[slot].First == LED_SLOT_UNMAPPED){
+        return WS2812B_Error;
+    }
+    *first = LED_SlotTable[slot].First;
+    *count = LED_SlotTable[slot].Count;
+    return WS2812B_OK;
+}
+
+// Color every LED of the slot beneath the layers, shows with the next LED_Layer_Process
+WS2812B_Result LED_Slot_Set(LED_Layers *layers, uint8_t slot, LED_Color color){
+    uint16_t first, count;
+    if(layers == NULL || LED_SlotTable_Get(slot, &first, &count) != WS2812B_OK){
+        return WS2812B_Error;
+    }
+    return LED_Layer_Draw(layers, first, count, color);
+}
+
+WS2812B_Result LED_Slot_Clear(LED_Layers *layers, uint8_t slot){
+    return LED_Slot_Set(layers, slot, (LED_Color){0});
+}
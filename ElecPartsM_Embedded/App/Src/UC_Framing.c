@@ -0,0 +1,63 @@
+#include "UC_Framing.h"
+
+uint8_t UC_Framing_CRC8(const uint8_t *data, uint16_t length){
+    uint8_t crc = 0;
+    while(length--){
+        crc ^= *data++;
+        for(uint8_t bit = 0; bit < 8; bit++){
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ UC_FRAMING_CRC_POLY) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/* Append the CRC, COBS encode and terminate with the delimiter.
+ * out holds UC_FRAMING_MAX_ENCODED(length) bytes, returns the bytes written. */
+uint16_t UC_Framing_Encode(const uint8_t *frame, uint16_t length, uint8_t *out){
+    uint8_t crc = UC_Framing_CRC8(frame, length);
+    uint16_t codePos = 0; // code byte of the current block, written once the block ends
+    uint16_t pos = 1;
+    uint8_t code = 1;
+
+    for(uint16_t i = 0; i <= length; i++){
+        uint8_t byte = (i < length) ? frame[i] : crc;
+        if(byte != 0){
+            out[pos++] = byte;
+            code++;
+        }
+        // A zero ends the block, so does reaching the 254 byte maximum
+        if(byte == 0 || code == 0xFF){
+            out[codePos] = code;
+            codePos = pos++;
+            code = 1;
+        }
+    }
+    out[codePos] = code;
+    out[pos++] = UC_FRAME_DELIMITER;
+    return pos;
+}
+
+/* Decode the bytes received before a delimiter in place and check the CRC.
+ * Returns the frame length without the CRC, 0 when the frame is malformed or corrupted. */
+uint16_t UC_Framing_Decode(uint8_t *buf, uint16_t length){
+    uint16_t in = 0;
+    uint16_t out = 0;
+    while(in < length){
+        uint8_t code = buf[in++];
+        if(code == UC_FRAME_DELIMITER || code - 1 > length - in){
+            return 0;
+        }
+        // Output never gets ahead of input, the code byte has been consumed
+        for(uint8_t i = 1; i < code; i++){
+            buf[out++] = buf[in++];
+        }
+        if(code != 0xFF && in < length){
+            buf[out++] = 0;
+        }
+    }
+    // A CRC over the frame and its own CRC comes out 0
+    if(out < 2 || UC_Framing_CRC8(buf, out) != 0){
+        return 0;
+    }
+    return out - 1;
+}
@@ -0,0 +1,198 @@
+#include "UC_Port.h"
+
+// Ports registered by UC_Port_Init, used to route the UART callbacks
+static UC_Port *UC_Ports[UC_PORT_NUM];
+static uint8_t UC_PortNum;
+
+static HAL_StatusTypeDef UC_Port_StartRx(UC_Port *port){
+    UART_HandleTypeDef *huart = port->Handle;
+    if(huart->hdmarx != NULL){
+        // The DMA position is the ring head, the transfer wraps on its own
+        return HAL_UARTEx_ReceiveToIdle_DMA(huart, port->RxRing, UC_PORT_RX_SIZE);
+    }
+    // Interrupt mode stops at the end of the ring, the next reception starts over at its beginning
+    port->RxStart = port->RxHead;
+    return HAL_UARTEx_ReceiveToIdle_IT(huart, &port->RxRing[port->RxStart], UC_PORT_RX_SIZE - port->RxStart);
+}
+
+HAL_StatusTypeDef UC_Port_Init(UC_Port *port){
+    if(port == NULL || port->Handle == NULL){
+        return HAL_ERROR;
+    }
+    uint8_t registered = 0;
+    for(uint8_t i = 0; i < UC_PortNum; i++){
+        registered |= (UC_Ports[i] == port);
+    }
+    if(!registered){
+        if(UC_PortNum >= UC_PORT_NUM){
+            return HAL_ERROR;
+        }
+        UC_Ports[UC_PortNum++] = port;
+    }
+    port->RxHead = 0;
+    port->RxTail = 0;
+    port->RxRestarted = 0;
+    port->RxTotal = 0;
+    port->RxRead = 0;
+    port->RxErrors = 0;
+    port->RxOverruns = 0;
+    port->TxHead = 0;
+    port->TxTail = 0;
+    port->TxLength = 0;
+    return UC_Port_StartRx(port);
+}
+
+/* Bytes received so far and the ring position they reach, read from the transfer itself so bytes
+ * can be picked up as they land instead of at the next reception event */
+static uint16_t UC_Port_LiveHead(UC_Port *port, uint32_t *total){
+    UART_HandleTypeDef *huart = port->Handle;
+    uint16_t head = port->RxHead;
+    uint16_t received = 0;
+    if(huart->RxState == HAL_UART_STATE_BUSY_RX){
+        if(huart->hdmarx != NULL){
+            head = (UC_PORT_RX_SIZE - __HAL_DMA_GET_COUNTER(huart->hdmarx)) % UC_PORT_RX_SIZE;
+            received = (head + UC_PORT_RX_SIZE - port->RxHead) % UC_PORT_RX_SIZE;
+        }else{
+            received = huart->RxXferSize - huart->RxXferCount;
+            head = (port->RxStart + received) % UC_PORT_RX_SIZE;
+        }
+    }
+    *total = port->RxTotal + received;
+    return head;
+}
+
+/* Copy out what arrived since the last read, up to size bytes. lost is set when bytes went missing
+ * before the ones returned, to a UART error or to the reception overrunning the ring, and the
+ * reader has to find the next frame start again. */
+uint16_t UC_Port_Read(UC_Port *port, uint8_t *data, uint16_t size, uint8_t *lost){
+    *lost = 0;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if(port->RxRestarted){
+        // Whatever was left unread belonged to the broken reception, the new one started at the ring start
+        port->RxRestarted = 0;
+        port->RxTail = 0;
+        port->RxRead = port->RxTotal - port->RxHead;
+        *lost = 1;
+    }
+    uint32_t total;
+    uint16_t head = UC_Port_LiveHead(port, &total);
+    __set_PRIMASK(primask);
+
+    uint32_t unread = total - port->RxRead;
+    if(unread > UC_PORT_RX_SIZE){
+        // The reception moved further than the ring had free and wrote over unread bytes
+        port->RxOverruns++;
+        port->RxTail = head;
+        port->RxRead = total;
+        *lost = 1;
+        return 0;
+    }
+    uint16_t count = 0;
+    while(count < unread && count < size){
+        data[count++] = port->RxRing[port->RxTail];
+        port->RxTail = (port->RxTail + 1) % UC_PORT_RX_SIZE;
+    }
+    port->RxRead += count;
+    return count;
+}
+
+// HAL_UARTEx_RxEventCallback: size is the DMA position in the ring, or the bytes of the IT reception
+void UC_Port_RxEventIT(UC_Port *port, uint16_t size){
+    if(port == NULL){
+        return;
+    }
+    if(port->Handle->hdmarx != NULL){
+        // Events come at least every half ring, the distance from the last one is the bytes received
+        port->RxTotal += (size + UC_PORT_RX_SIZE - port->RxHead) % UC_PORT_RX_SIZE;
+        port->RxHead = size % UC_PORT_RX_SIZE;
+        return;
+    }
+    port->RxTotal += size;
+    port->RxHead = (port->RxStart + size) % UC_PORT_RX_SIZE;
+    if(port->Handle->RxState == HAL_UART_STATE_READY){
+        UC_Port_StartRx(port);
+    }
+}
+
+// Noise, framing or overrun errors abort the reception, pick it up again
+void UC_Port_ErrorIT(UC_Port *port){
+    if(port == NULL){
+        return;
+    }
+    if(port->TxLength != 0 && port->Handle->gState == HAL_UART_STATE_READY){
+        // Transfer aborted, give up on its bytes rather than stall the queue
+        UC_Port_TxCpltIT(port);
+    }
+    if(port->Handle->RxState != HAL_UART_STATE_READY){
+        return;
+    }
+    port->RxErrors++;
+    if(port->Handle->hdmarx != NULL){
+        // A new circular transfer starts over at the beginning of the ring
+        port->RxHead = 0;
+        port->RxRestarted = 1;
+    }
+    UC_Port_StartRx(port);
+}
+
+/* Transmit queue ----------------------------------------------------------*/
+
+// Start sending the queued bytes if the UART is idle, callable from the main loop and the callbacks
+static void UC_Port_StartTx(UC_Port *port){
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint16_t tail = port->TxTail;
+    if(port->TxLength == 0 && port->TxHead != tail){
+        // One contiguous run, the part wrapped to the ring start goes with the next transfer
+        uint16_t length = (port->TxHead > tail) ? (port->TxHead - tail) : (UC_PORT_TX_SIZE - tail);
+        HAL_StatusTypeDef status;
+        if(port->Handle->hdmatx != NULL){
+            status = HAL_UART_Transmit_DMA(port->Handle, &port->TxRing[tail], length);
+        }else{
+            status = HAL_UART_Transmit_IT(port->Handle, &port->TxRing[tail], length);
+        }
+        if(status == HAL_OK){
+            port->TxLength = length;
+        }
+    }
+    __set_PRIMASK(primask);
+}
+
+/* Queue bytes to send and return without waiting for the wire. All or nothing: when they do not
+ * fit the queue is left untouched and HAL_BUSY returned, the caller drops or retries them. */
+HAL_StatusTypeDef UC_Port_Write(UC_Port *port, const uint8_t *data, uint16_t size){
+    if(port == NULL){
+        return HAL_ERROR;
+    }
+    // One ring byte stays free to tell a full queue from an empty one
+    uint16_t space = (port->TxTail + UC_PORT_TX_SIZE - port->TxHead - 1) % UC_PORT_TX_SIZE;
+    if(size > space){
+        return HAL_BUSY;
+    }
+    for(uint16_t i = 0; i < size; i++){
+        port->TxRing[port->TxHead] = data[i];
+        port->TxHead = (port->TxHead + 1) % UC_PORT_TX_SIZE;
+    }
+    UC_Port_StartTx(port);
+    return HAL_OK;
+}
+
+// HAL_UART_TxCpltCallback: drop the bytes sent and chain the next transfer
+void UC_Port_TxCpltIT(UC_Port *port){
+    if(port == NULL){
+        return;
+    }
+    port->TxTail = (port->TxTail + port->TxLength) % UC_PORT_TX_SIZE;
+    port->TxLength = 0;
+    UC_Port_StartTx(port);
+}
+
+UC_Port *UC_Port_Find(UART_HandleTypeDef *huart){
+    for(uint8_t i = 0; i < UC_PortNum; i++){
+        if(UC_Ports[i]->Handle == huart){
+            return UC_Ports[i];
+        }
+    }
+    return NULL;
+}
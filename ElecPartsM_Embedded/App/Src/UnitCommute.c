@@ -1,18 +1,121 @@
 #include "UnitCommute.h"
 #include "usart.h"
+#include "UC_Port.h"
+#include "LED_Effect.h"
+#include "LED_Animation.h"
+#include "LED_Highlight.h"
+#include "LED_SlotTable.h"
+#include "LED_Layer.h"
+
+// One of each per strip, indexed by the strip byte of the LED commands
+extern LED_Effects ledEffects[WS2812B_MAX_STRIP_NUM];
+extern LED_Animation ledAnimation[WS2812B_MAX_STRIP_NUM];
+extern LED_Highlights ledHighlights[WS2812B_MAX_STRIP_NUM];
+extern LED_Layers ledLayers[WS2812B_MAX_STRIP_NUM];
+extern UC_Port ucPorts[UC_PORT_NUM];
 
 UnitData unitData;
-uint8_t UC_FrameBuf[UC_FRAME_MAX_SIZE];
+static UC_Parser UC_Parsers[UC_DIRECTION_NUM];
+static UC_Outbox UC_Outboxes[UC_PORT_NUM];
 uint8_t UC_LastFrameDirection = 1; // UART1: 1, UART2: 2
 
 uint8_t is_SetID_NextUnitReply = 0;
 
-void ProcessUC_Frame(uint8_t length){
+static void Send_UCFrame(UC_Frame frame);
+static void Send_UCBytes(uint8_t port, const uint8_t *data, uint16_t length);
+static HAL_StatusTypeDef Forward_UCBytes(uint8_t direction, const uint8_t *data, uint16_t length);
+static void Flush_UCOutbox(uint8_t port);
+static uint8_t Take_UCStrip(uint8_t **data, uint8_t *length);
+static void ProcessUC_SetID(uint8_t id);
+static void ProcessUC_HighlightPart(uint8_t msg, uint8_t *data, uint8_t length);
+static void ProcessUC_SlotTable(uint8_t msg, uint8_t *data, uint8_t length);
+static void ProcessUC_Layer(uint8_t layer, uint8_t *data, uint8_t length);
+static void ProcessUC_StartEffect(uint8_t type, uint8_t *data, uint8_t length);
+static void ProcessUC_Animation(uint8_t msg, uint8_t *data, uint8_t length);
+
+/* Bytes received on one port, every frame they complete is processed.
+ * Frames for other units are cut through: once the id byte shows the frame is not ours, it and
+ * everything up to the delimiter go straight out of the other port as they arrive, still encoded. */
+void UC_Receive(uint8_t direction, const uint8_t *data, uint16_t length){
+    if(direction == 0 || direction > UC_DIRECTION_NUM)
+        return;
+    UC_Parser *parser = &UC_Parsers[direction - 1];
+    for(uint16_t i = 0; i < length; i++){
+        // A first code byte above 1 means the id is not 0 (broadcast) and is the byte after it
+        if(parser->Length == 1 && !parser->Overflow && data[i] != UC_FRAME_DELIMITER &&
+           parser->FrameBuf[0] > 1 && data[i] != unitData.id){
+            parser->Length = 0;
+            if(Forward_UCBytes(direction, parser->FrameBuf, 1) == HAL_OK)
+                parser->Forwarding = 1;
+            else
+                parser->Overflow = 1;
+        }
+        if(parser->Forwarding){
+            uint16_t end = i;
+            while(end < length && data[end] != UC_FRAME_DELIMITER)
+                end++;
+            if(end < length){
+                end++;
+                parser->Forwarding = 0;
+            }
+            if(Forward_UCBytes(direction, &data[i], end - i) != HAL_OK && parser->Forwarding){
+                // The other port is backed up, skip the rest of the frame
+                parser->Forwarding = 0;
+                parser->Overflow = 1;
+            }
+            i = end - 1;
+            continue;
+        }
+        if(data[i] == UC_FRAME_DELIMITER){
+            // Empty frames are only delimiters sent to resync the line
+            if(!parser->Overflow && parser->Length > 0){
+                uint16_t frameLength = UC_Framing_Decode(parser->FrameBuf, parser->Length);
+                if(frameLength > 0)
+                    ProcessUC_Frame(direction, parser->FrameBuf, frameLength);
+                else
+                    parser->Dropped++;
+            }
+            parser->Length = 0;
+            parser->Overflow = 0;
+        }else if(parser->Length < UC_FRAME_ENCODED_SIZE){
+            parser->FrameBuf[parser->Length++] = data[i];
+        }else{
+            parser->Overflow = 1;
+        }
+    }
+}
+
+/* Bytes received on a port were lost: the frame they belonged to is skipped up to its delimiter.
+ * A frame being cut through is ended early, like one the other port had no room for. */
+void UC_Resync(uint8_t direction){
+    if(direction == 0 || direction > UC_DIRECTION_NUM)
+        return;
+    UC_Parser *parser = &UC_Parsers[direction - 1];
+    if(parser->Forwarding){
+        UC_Outbox *box = &UC_Outboxes[(direction == 1) ? 1 : 0];
+        box->ForwardOpen = 1;
+        box->Truncated = 1;
+        parser->Forwarding = 0;
+    }
+    parser->Length = 0;
+    parser->Overflow = 1;
+}
+
+// Main loop side: send what the outboxes held back once their ports have room
+void UC_Process(void){
+    for(uint8_t port = 0; port < UC_PORT_NUM; port++){
+        Flush_UCOutbox(port);
+    }
+}
+
+void ProcessUC_Frame(uint8_t direction, uint8_t *buf, uint8_t length){
     if(length<2)
         return;
-    uint8_t id = UC_FrameBuf[0];
-    enum UC_Command cmd = (UC_FrameBuf[1] & 0xF0) >> 4;
-    uint8_t msg = (UC_FrameBuf[1] & 0x0F);
+    // Replies go back out of the port the frame came from
+    UC_LastFrameDirection = direction;
+    uint8_t id = buf[0];
+    enum UC_Command cmd = (buf[1] & 0xF0) >> 4;
+    uint8_t msg = (buf[1] & 0x0F);
     
     if(id != unitData.id && id != 0){
         return;
@@ -21,9 +124,9 @@ void ProcessUC_Frame(uint8_t length){
     if(id == 0){
         UC_Frame frame;
         frame.id = id;
-        frame.Cmd_Msg = cmd << 4 + msg;
+        frame.Cmd_Msg = (cmd << 4) + msg;
         frame.OptDataLength = length - 2;
-        frame.OptData = &UC_FrameBuf[2];
+        frame.OptData = &buf[2];
         frame.SendDirection = UC_Upstream;
         Send_UCFrame(frame);
     }
@@ -33,7 +136,22 @@ void ProcessUC_Frame(uint8_t length){
     case UC_SetID:
         ProcessUC_SetID(id);
         break;
-    
+    case UC_HighlightPart:
+        ProcessUC_HighlightPart(msg, &buf[2], length - 2);
+        break;
+    case UC_SlotTable:
+        ProcessUC_SlotTable(msg, &buf[2], length - 2);
+        break;
+    case UC_Layer:
+        ProcessUC_Layer(msg, &buf[2], length - 2);
+        break;
+    case UC_StartEffect:
+        ProcessUC_StartEffect(msg, &buf[2], length - 2);
+        break;
+    case UC_Animation:
+        ProcessUC_Animation(msg, &buf[2], length - 2);
+        break;
+
         
     default:
         break;
@@ -42,6 +160,7 @@ void ProcessUC_Frame(uint8_t length){
 
 static void Send_UCFrame(UC_Frame frame){
     uint8_t buf[UC_FRAME_MAX_SIZE];
+    uint8_t encoded[UC_FRAMING_MAX_ENCODED(UC_FRAME_MAX_SIZE)];
     uint8_t bufLength = 2;
     buf[0] = frame.id;
     buf[1] = frame.Cmd_Msg;
@@ -55,16 +174,66 @@ static void Send_UCFrame(UC_Frame frame){
         }
     }
 
+    uint16_t encodedLength = UC_Framing_Encode(buf, bufLength, encoded);
+
     if(UC_LastFrameDirection == 1){
         if(frame.SendDirection == UC_Upstream)
-            HAL_UART_Transmit(&huart1, buf, bufLength, HAL_MAX_DELAY);
+            Send_UCBytes(0, encoded, encodedLength);
         else
-            HAL_UART_Transmit(&huart2, buf, bufLength, HAL_MAX_DELAY);
+            Send_UCBytes(1, encoded, encodedLength);
     }else if(UC_LastFrameDirection == 2){
         if(frame.SendDirection == UC_Upstream)
-            HAL_UART_Transmit(&huart2, buf, bufLength, HAL_MAX_DELAY);
+            Send_UCBytes(1, encoded, encodedLength);
         else
-            HAL_UART_Transmit(&huart1, buf, bufLength, HAL_MAX_DELAY);
+            Send_UCBytes(0, encoded, encodedLength);
+    }
+}
+
+/* Queue a whole local frame on a port, the UART sends it in the background.
+ * While a forwarded frame is half queued there the local one would land inside it, and
+ * while the queue is full it does not fit: either way it is held and sent later. */
+static void Send_UCBytes(uint8_t port, const uint8_t *data, uint16_t length){
+    UC_Outbox *box = &UC_Outboxes[port];
+    if(box->ForwardOpen || box->Length > 0 || UC_Port_Write(&ucPorts[port], data, length) != HAL_OK){
+        if(box->Length + length > UC_OUTBOX_SIZE){
+            box->Dropped++;
+            return;
+        }
+        for(uint16_t i = 0; i < length; i++){
+            box->Held[box->Length++] = data[i];
+        }
+    }
+}
+
+/* Pass bytes on to the port opposite the one they came from, never waiting for room.
+ * Bytes that do not fit abandon the forward: the frame is cut short and the delimiter owed
+ * for it goes out as soon as there is room, so the next unit drops it on its CRC. */
+static HAL_StatusTypeDef Forward_UCBytes(uint8_t direction, const uint8_t *data, uint16_t length){
+    uint8_t port = (direction == 1) ? 1 : 0;
+    UC_Outbox *box = &UC_Outboxes[port];
+    Flush_UCOutbox(port);
+    if(box->Truncated || UC_Port_Write(&ucPorts[port], data, length) != HAL_OK){
+        box->ForwardOpen = 1;
+        box->Truncated = 1;
+        return HAL_BUSY;
+    }
+    // Chunks end at the delimiter or at the end of what has been received so far
+    box->ForwardOpen = (data[length - 1] != UC_FRAME_DELIMITER);
+    Flush_UCOutbox(port);
+    return HAL_OK;
+}
+
+static void Flush_UCOutbox(uint8_t port){
+    UC_Outbox *box = &UC_Outboxes[port];
+    if(box->Truncated){
+        uint8_t delimiter = UC_FRAME_DELIMITER;
+        if(UC_Port_Write(&ucPorts[port], &delimiter, 1) != HAL_OK)
+            return;
+        box->Truncated = 0;
+        box->ForwardOpen = 0;
+    }
+    if(!box->ForwardOpen && box->Length > 0 && UC_Port_Write(&ucPorts[port], box->Held, box->Length) == HAL_OK){
+        box->Length = 0;
     }
 }
 
@@ -106,4 +275,171 @@ static void ProcessUC_SetID(uint8_t id) {
         frame.SendDirection = UC_Upstream;
         Send_UCFrame(frame);
     }
+}
+
+// Strip byte leading the data of an LED command, WS2812B_MAX_STRIP_NUM when missing or out of range
+static uint8_t Take_UCStrip(uint8_t **data, uint8_t *length){
+    if(*length == 0 || (*data)[0] >= WS2812B_MAX_STRIP_NUM)
+        return WS2812B_MAX_STRIP_NUM;
+    uint8_t strip = (*data)[0];
+    *data += 1;
+    *length -= 1;
+    return strip;
+}
+
+static void ProcessUC_HighlightPart(uint8_t msg, uint8_t *data, uint8_t length){
+    uint8_t strip = Take_UCStrip(&data, &length);
+    if(strip >= WS2812B_MAX_STRIP_NUM){
+        return;
+    }
+    uint16_t first, count;
+    if(msg == UC_HighlightSlot){
+        if(length < 4 || LED_SlotTable_Get(data[0], &first, &count) != WS2812B_OK){
+            return;
+        }
+        data += 1;
+        length -= 1;
+    }else{
+        if(length < 6){
+            return;
+        }
+        first = (data[0] << 8) | data[1];
+        count = data[2];
+        data += 3;
+        length -= 3;
+    }
+    LED_Color color = {.R = data[0], .G = data[1], .B = data[2]};
+    // Without a timeout the part stays lit until the host highlights it again
+    uint32_t timeout = 0;
+    if(length >= 5){
+        timeout = ((data[3] << 8) | data[4]) * 100UL;
+    }
+    LED_Highlight_Set(&ledHighlights[strip], first, count, color, timeout);
+}
+
+// The slot table is shared by the strips, setting and clearing a slot names the strip it lies on
+static void ProcessUC_SlotTable(uint8_t msg, uint8_t *data, uint8_t length){
+    uint8_t strip;
+    switch (msg)
+    {
+    case UC_SlotErase:
+        LED_SlotTable_Erase();
+        break;
+    case UC_SlotMap:
+        for(uint8_t i = 0; i + 4 <= length; i += 4){
+            LED_SlotTable_Map(data[i], (data[i + 1] << 8) | data[i + 2], data[i + 3]);
+        }
+        break;
+    case UC_SlotSet:
+        strip = Take_UCStrip(&data, &length);
+        if(strip < WS2812B_MAX_STRIP_NUM && length >= 4){
+            LED_Color color = {.R = data[1], .G = data[2], .B = data[3]};
+            LED_Slot_Set(&ledLayers[strip], data[0], color);
+        }
+        break;
+    case UC_SlotClear:
+        strip = Take_UCStrip(&data, &length);
+        if(strip < WS2812B_MAX_STRIP_NUM && length >= 1)
+            LED_Slot_Clear(&ledLayers[strip], data[0]);
+        break;
+    default:
+        break;
+    }
+}
+
+static void ProcessUC_StartEffect(uint8_t type, uint8_t *data, uint8_t length){
+    uint8_t strip = Take_UCStrip(&data, &length);
+    if(strip >= WS2812B_MAX_STRIP_NUM){
+        return;
+    }
+    LED_Effects *fx = &ledEffects[strip];
+    if(type == LED_Effect_None){
+        // No effect type: stop everything on the strip, or only the effect starting at the given LED
+        if(length >= 2){
+            LED_Effect_Stop(fx, (data[0] << 8) | data[1]);
+        }else{
+            LED_Effect_StopAll(fx);
+        }
+        return;
+    }
+    if(length < 8){
+        return;
+    }
+    uint16_t first = (data[0] << 8) | data[1];
+    LED_Color color = {.R = data[3], .G = data[4], .B = data[5]};
+    uint16_t period = (data[6] << 8) | data[7];
+    LED_Effect_Start(fx, type, first, data[2], color, period);
+}
+
+static void ProcessUC_Animation(uint8_t msg, uint8_t *data, uint8_t length){
+    uint8_t strip = Take_UCStrip(&data, &length);
+    if(strip >= WS2812B_MAX_STRIP_NUM){
+        return;
+    }
+    LED_Animation *anim = &ledAnimation[strip];
+    switch (msg)
+    {
+    case UC_AnimStop:
+        LED_Animation_Stop(anim);
+        break;
+    case UC_AnimPlay:
+        if(length >= 1)
+            LED_Animation_Play(anim, data[0]);
+        break;
+    case UC_AnimBegin:
+        if(length >= 1){
+            // The slot is erased, no strip may keep playing it
+            for(uint8_t i = 0; i < WS2812B_MAX_STRIP_NUM; i++){
+                LED_Animation_StopSlot(&ledAnimation[i], data[0]);
+            }
+            LED_Animation_BeginUpload(anim, data[0]);
+        }
+        break;
+    case UC_AnimKey:
+        if(length >= 8){
+            LED_Keyframe key = {
+                .Time_ms = (data[0] << 8) | data[1],
+                .First = (data[2] << 8) | data[3],
+                .Count = data[4],
+                .R = data[5],
+                .G = data[6],
+                .B = data[7]
+            };
+            LED_Animation_AddKeyframe(anim, &key);
+        }
+        break;
+    case UC_AnimEnd:
+        if(length >= 3)
+            LED_Animation_EndUpload(anim, (data[0] << 8) | data[1], data[2]);
+        break;
+    default:
+        break;
+    }
+}
+
+// Each requester draws on its own layer, so clearing one highlight leaves the others intact
+static void ProcessUC_Layer(uint8_t layer, uint8_t *data, uint8_t length){
+    uint8_t strip = Take_UCStrip(&data, &length);
+    if(strip >= WS2812B_MAX_STRIP_NUM){
+        return;
+    }
+    LED_Layers *layers = &ledLayers[strip];
+    if(length == 0){
+        LED_Layer_ClearAll(layers, layer);
+        return;
+    }
+    if(length == 1){
+        LED_Layer_SetMode(layers, layer, data[0]);
+        return;
+    }
+    if(length < 3){
+        return;
+    }
+    uint16_t first = (data[0] << 8) | data[1];
+    if(length >= 6){
+        LED_Color color = {.R = data[3], .G = data[4], .B = data[5]};
+        LED_Layer_Set(layers, layer, first, data[2], color);
+    }else{
+        LED_Layer_Clear(layers, layer, first, data[2]);
+    }
 }
\ No newline at end of file
@@ -1,11 +1,208 @@
 #include "WS2812B_Driver.h"
 #include "spi.h"
+#include <string.h>
 
-WS2812B_Result WS2812B_SetLEDColor(WS2812B *strip, uint8_t led_index, LED_Color color){
-    if(strip == NULL || led_index >= WS2812B_MAX_LED_NUM){
+// Strips registered by WS2812B_Init, used to route interrupts and share DMA channels
+static WS2812B *WS2812B_Strips[WS2812B_MAX_STRIP_NUM];
+static uint8_t WS2812B_StripNum;
+// Set by WS2812B_Hold, frames requested meanwhile queue until WS2812B_Resume
+static volatile uint8_t WS2812B_Held;
+
+// HAL_TIM_ActiveChannel bit of a TIM_CHANNEL_x
+#define WS2812B_ACTIVE_CHANNEL(channel) (1U << ((channel) >> 2))
+// Compare interrupt of a TIM_CHANNEL_x, TIM_IT_CC1..4 are consecutive DIER bits
+#define WS2812B_LATCH_IT(channel) (TIM_IT_CC1 << ((channel) >> 2))
+
+// WS2812B.SlotState values
+enum {
+    WS2812B_SlotUnknown = 0,
+    WS2812B_SlotColor,
+    WS2812B_SlotZero
+};
+
+static inline void WS2812B_MarkDirty(WS2812B *strip, uint16_t led_index){
+    if(led_index >= strip->DirtyEnd){
+        strip->DirtyEnd = led_index + 1;
+    }
+}
+
+static uint16_t WS2812B_Intensity(LED_Color color);
+
+// The output changes without a framebuffer change, the next frame sends every LED
+static void WS2812B_ResendAll(WS2812B *strip){
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    strip->SendEnd = strip->LED_Num;
+    __set_PRIMASK(primask);
+}
+
+#if WS2812B_PALETTE_BITS
+// Every uint8_t is an entry of a 256 color palette
+#if WS2812B_PALETTE_BITS == 8
+#define WS2812B_PALETTE_INDEX_OK(index) 1
+#else
+#define WS2812B_PALETTE_INDEX_OK(index) ((index) < WS2812B_PALETTE_SIZE)
+#endif
+
+static inline uint8_t WS2812B_ReadIndex(const WS2812B_Pixel *frame, uint16_t led_index){
+#if WS2812B_PALETTE_BITS == 4
+    uint8_t packed = frame[led_index >> 1];
+    return (led_index & 1) ? (packed >> 4) : (packed & 0x0F);
+#else
+    return frame[led_index];
+#endif
+}
+
+// Store a palette index and grow the dirty prefix if the LED actually changed
+static inline void WS2812B_StoreIndex(WS2812B *strip, uint16_t led_index, uint8_t palette_index){
+    uint8_t old_index = WS2812B_ReadIndex(strip->Back, led_index);
+    if(old_index == palette_index){
+        return;
+    }
+    if(--strip->PaletteUse[old_index] == 0){
+        strip->PaletteFreed[old_index >> 3] |= 1 << (old_index & 7);
+    }
+    strip->PaletteUse[palette_index]++;
+    strip->IntensitySum += WS2812B_Intensity(strip->Palette[palette_index]);
+    strip->IntensitySum -= WS2812B_Intensity(strip->Palette[old_index]);
+#if WS2812B_PALETTE_BITS == 4
+    uint8_t *packed = &strip->Back[led_index >> 1];
+    *packed = (led_index & 1) ? ((*packed & 0x0F) | (palette_index << 4)) : ((*packed & 0xF0) | palette_index);
+#else
+    strip->Back[led_index] = palette_index;
+#endif
+    WS2812B_MarkDirty(strip, led_index);
+}
+
+// Change a palette entry, the LEDs using it change their intensity with it
+static void WS2812B_WritePalette(WS2812B *strip, uint8_t palette_index, LED_Color color){
+    uint32_t use = strip->PaletteUse[palette_index];
+    uint16_t old_intensity = WS2812B_Intensity(strip->Palette[palette_index]);
+    uint16_t new_intensity = WS2812B_Intensity(color);
+    strip->Palette[palette_index] = color;
+    // The palette is shared by both buffers, the front estimate follows with the back use count
+    strip->IntensitySum += use * new_intensity - use * old_intensity;
+    strip->FrontIntensity += use * new_intensity - use * old_intensity;
+}
+
+/* Palette entry showing the color. Without one the color takes over an entry neither buffer
+ * uses: unused by Back and not freed since the last commit, so Front does not show it either.
+ * Appended behind the used entries otherwise, -1 if the palette is full. */
+static int16_t WS2812B_PaletteLookup(WS2812B *strip, LED_Color color){
+    int16_t unused = -1;
+    for(uint16_t i = 0; i < strip->PaletteUsed; i++){
+        if(WS2812B_SameColor(strip->Palette[i], color)){
+            return i;
+        }
+        if(unused < 0 && strip->PaletteUse[i] == 0 && !(strip->PaletteFreed[i >> 3] & (1 << (i & 7)))){
+            unused = i;
+        }
+    }
+    if(unused < 0){
+        if(strip->PaletteUsed >= WS2812B_PALETTE_SIZE){
+            return -1;
+        }
+        unused = strip->PaletteUsed++;
+    }
+    WS2812B_WritePalette(strip, unused, color);
+    return unused;
+}
+
+static inline WS2812B_Result WS2812B_StoreLED(WS2812B *strip, uint16_t led_index, LED_Color color){
+    int16_t palette_index = WS2812B_PaletteLookup(strip, color);
+    if(palette_index < 0){
+        return WS2812B_Error;
+    }
+    WS2812B_StoreIndex(strip, led_index, palette_index);
+    return WS2812B_OK;
+}
+
+static inline LED_Color WS2812B_FrameColor(WS2812B *strip, const WS2812B_Pixel *frame, uint16_t led_index){
+    return strip->Palette[WS2812B_ReadIndex(frame, led_index)];
+}
+
+WS2812B_Result WS2812B_SetLEDIndex(WS2812B *strip, uint16_t led_index, uint8_t palette_index){
+    if(strip == NULL || led_index >= strip->LED_Num || !WS2812B_PALETTE_INDEX_OK(palette_index)){
+        return WS2812B_Error;
+    }
+    WS2812B_StoreIndex(strip, led_index, palette_index);
+    return WS2812B_OK;
+}
+
+// Recolors every LED using the entry without touching the framebuffers, shows with the next frame sent
+WS2812B_Result WS2812B_SetPaletteColor(WS2812B *strip, uint8_t palette_index, LED_Color color){
+    if(strip == NULL || !WS2812B_PALETTE_INDEX_OK(palette_index)){
+        return WS2812B_Error;
+    }
+    if(palette_index >= strip->PaletteUsed){
+        strip->PaletteUsed = palette_index + 1;
+    }else if(WS2812B_SameColor(strip->Palette[palette_index], color)){
+        return WS2812B_OK;
+    }
+    WS2812B_WritePalette(strip, palette_index, color);
+    // Which LEDs use the entry is not tracked, resend the whole strip
+    WS2812B_ResendAll(strip);
+    return WS2812B_OK;
+}
+#else
+// Store a color and grow the dirty prefix if the LED actually changed
+static inline WS2812B_Result WS2812B_StoreLED(WS2812B *strip, uint16_t led_index, LED_Color color){
+    if(WS2812B_SameColor(strip->Back[led_index], color)){
+        return WS2812B_OK;
+    }
+    strip->IntensitySum += WS2812B_Intensity(color);
+    strip->IntensitySum -= WS2812B_Intensity(strip->Back[led_index]);
+    strip->Back[led_index] = color;
+    WS2812B_MarkDirty(strip, led_index);
+    return WS2812B_OK;
+}
+
+static inline LED_Color WS2812B_FrameColor(WS2812B *strip, const WS2812B_Pixel *frame, uint16_t led_index){
+    (void)strip;
+    return frame[led_index];
+}
+#endif
+
+// Color the LED has in the back buffer, including changes not committed yet
+LED_Color WS2812B_GetLEDColor(WS2812B *strip, uint16_t led_index){
+    return WS2812B_FrameColor(strip, strip->Back, led_index);
+}
+
+WS2812B_Result WS2812B_SetLEDColor(WS2812B *strip, uint16_t led_index, LED_Color color){
+    if(strip == NULL || led_index >= strip->LED_Num){
         return WS2812B_Error;
     }
-    strip->LEDs[led_index] = color;
+    return WS2812B_StoreLED(strip, led_index, color);
+}
+
+// One pass over a range: the color is resolved once and the dirty prefix grows once
+WS2812B_Result WS2812B_FillLEDColor(WS2812B *strip, uint16_t first, uint16_t count, LED_Color color){
+    if(strip == NULL || first + count > strip->LED_Num){
+        return WS2812B_Error;
+    }
+#if WS2812B_PALETTE_BITS
+    int16_t palette_index = WS2812B_PaletteLookup(strip, color);
+    if(palette_index < 0){
+        return WS2812B_Error;
+    }
+    for(uint16_t i = first; i < first + count; i++){
+        WS2812B_StoreIndex(strip, i, palette_index);
+    }
+#else
+    uint16_t intensity = WS2812B_Intensity(color);
+    uint16_t dirty = 0;
+    for(uint16_t i = first; i < first + count; i++){
+        if(!WS2812B_SameColor(strip->Back[i], color)){
+            strip->IntensitySum += intensity;
+            strip->IntensitySum -= WS2812B_Intensity(strip->Back[i]);
+            strip->Back[i] = color;
+            dirty = i + 1;
+        }
+    }
+    if(dirty){
+        WS2812B_MarkDirty(strip, dirty - 1);
+    }
+#endif
     return WS2812B_OK;
 }
 
@@ -13,21 +210,51 @@ WS2812B_Result WS2812B_SetAllLEDColor(WS2812B *strip, LED_Color color){
     if(strip == NULL || strip->LED_Num > WS2812B_MAX_LED_NUM){
         return WS2812B_Error;
     }
-    for(uint8_t i=0; i<strip->LED_Num; i++){
-        strip->LEDs[i] = color;
+    return WS2812B_FillLEDColor(strip, 0, strip->LED_Num, color);
+}
+
+WS2812B_Result WS2812B_LitTheLED(WS2812B *strip, uint16_t theLED, LED_Color color){
+    if(strip == NULL || strip->LED_Num > WS2812B_MAX_LED_NUM){
+        return WS2812B_Error;
+    }
+
+
+    for(uint16_t ledIndex = 0; ledIndex < strip->LED_Num; ledIndex++){
+        if(WS2812B_StoreLED(strip, ledIndex, (ledIndex == theLED) ? color : (LED_Color){0}) != WS2812B_OK){
+            return WS2812B_Error;
+        }
     }
     return WS2812B_OK;
 }
 
-WS2812B_Result WS2812B_LitTheLED(WS2812B *strip, uint8_t theLED, LED_Color color){
-    if(strip == NULL || strip->LED_Num > WS2812B_MAX_LED_NUM){
+// Changes only what goes out on the wire, the framebuffers stay as they were set
+WS2812B_Result WS2812B_SetBrightness(WS2812B *strip, uint8_t brightness){
+    if(strip == NULL){
         return WS2812B_Error;
     }
+    if(strip->Brightness == brightness){
+        return WS2812B_OK;
+    }
+    strip->Brightness = brightness;
+    strip->LUT_Stale = 1;
+    // Every LED looks different now, resend the whole strip
+    WS2812B_ResendAll(strip);
+    return WS2812B_OK;
+}
 
+// Intensity x level / (255 * 255) is the fraction of MA_PER_CHANNEL drawn, divided once per limit change
+static void WS2812B_SetLevelBudget(WS2812B *strip){
+    strip->LevelBudget = (uint32_t)strip->CurrentLimit_mA * 255 * 255 / WS2812B_MA_PER_CHANNEL;
+}
 
-    for(uint8_t ledIndex = 0; ledIndex < strip->LED_Num; ledIndex++){
-        strip->LEDs[ledIndex] = (ledIndex == theLED) ? color : (LED_Color){0, 0, 0};
+// Brightness is lowered at the next frame start whenever the committed colors would exceed the limit
+WS2812B_Result WS2812B_SetCurrentLimit(WS2812B *strip, uint16_t limit_mA){
+    if(strip == NULL){
+        return WS2812B_Error;
     }
+    strip->CurrentLimit_mA = limit_mA;
+    WS2812B_SetLevelBudget(strip);
+    WS2812B_ResendAll(strip);
     return WS2812B_OK;
 }
 
@@ -35,55 +262,602 @@ WS2812B_Result WS2812B_Init(WS2812B *strip){
     if(strip == NULL || strip->LED_Num == 0 || strip->LED_Num > WS2812B_MAX_LED_NUM){
         return WS2812B_Error;
     }
+    if(strip->Backend == NULL || strip->Handle == NULL || strip->LatchTimer == NULL || strip->Frames[0] == NULL){
+        return WS2812B_Error;
+    }
+    // Symbol patterns were resolved at compile time for this clock
+    if(HAL_RCC_GetPCLK1Freq() != WS2812B_PCLK_HZ){
+        return WS2812B_Error;
+    }
+    strip->DMA = strip->Backend->GetDMA(strip);
+    if(strip->DMA == NULL){
+        return WS2812B_Error;
+    }
+
+    uint8_t registered = 0;
+    for(uint8_t i = 0; i < WS2812B_StripNum; i++){
+        registered |= (WS2812B_Strips[i] == strip);
+    }
+    if(!registered){
+        if(WS2812B_StripNum >= WS2812B_MAX_STRIP_NUM){
+            return WS2812B_Error;
+        }
+        WS2812B_Strips[WS2812B_StripNum++] = strip;
+    }
     strip->Status = WS2812B_Idle;
+    strip->RefreshPending = 0;
+    strip->RequestedFrames = 0;
+    strip->CoalescedFrames = 0;
+    strip->TransmittedFrames = 0;
+    strip->LUT_Stale = 1;
+    WS2812B_SetLevelBudget(strip);
+    strip->SlotState[0] = WS2812B_SlotUnknown;
+    strip->SlotState[1] = WS2812B_SlotUnknown;
+#if WS2812B_PALETTE_BITS
+    if(strip->PaletteUsed == 0){
+        // Zeroed indexes point at entry 0, make it black
+        strip->Palette[0] = (LED_Color){0};
+        strip->PaletteUsed = 1;
+    }
+#endif
+    strip->Front = strip->Frames[0];
+    if(strip->Frames[1] != NULL){
+        strip->Back = strip->Frames[1];
+        memcpy(strip->Back, strip->Front, WS2812B_FRAME_BYTES(strip->LED_Num));
+    }else{
+        strip->Back = strip->Frames[0];
+    }
+    strip->DirtyEnd = 0;
+    // Only time the whole framebuffer is summed, the setters keep the sum up to date from here
+    strip->IntensitySum = 0;
+#if WS2812B_PALETTE_BITS
+    for(uint16_t i = 0; i < WS2812B_PALETTE_SIZE; i++){
+        strip->PaletteUse[i] = 0;
+    }
+    memset(strip->PaletteFreed, 0, sizeof(strip->PaletteFreed));
+    for(uint16_t i = 0; i < strip->LED_Num; i++){
+        strip->PaletteUse[WS2812B_ReadIndex(strip->Back, i)]++;
+    }
+    for(uint16_t i = 0; i < WS2812B_PALETTE_SIZE; i++){
+        strip->IntensitySum += (uint32_t)strip->PaletteUse[i] * WS2812B_Intensity(strip->Palette[i]);
+    }
+#else
+    for(uint16_t i = 0; i < strip->LED_Num; i++){
+        strip->IntensitySum += WS2812B_Intensity(strip->Back[i]);
+    }
+#endif
+    strip->FrontIntensity = strip->IntensitySum;
+    // The strip state is unknown after power up, send everything once
+    strip->SendEnd = strip->LED_Num;
     return WS2812B_OK;
 }
 
-WS2812B_Result WS2812B_StartRefresh(WS2812B *strip){
-    if(strip == NULL || strip->Status != WS2812B_Idle){
-        return WS2812B_Error;
+/* SPI backend -------------------------------------------------------------*/
+
+#if WS2812B_SPI_3BIT_SYMBOLS
+// 3-bit SPI symbols for one LED bit, 1.2us each at 2.5MHz
+#define WS2812B_SYMBOL(nibble, bit) (((nibble) & (1 << (bit))) ? WS2812B_SPI_SYMBOL_1 : WS2812B_SPI_SYMBOL_0)
+#define WS2812B_NIBBLE_SYMBOLS(nibble) \
+    (WS2812B_SYMBOL(nibble, 3) << 9 | WS2812B_SYMBOL(nibble, 2) << 6 | WS2812B_SYMBOL(nibble, 1) << 3 | WS2812B_SYMBOL(nibble, 0))
+
+// Nibble -> 12 packed symbol bits, MSB first
+static const uint16_t WS2812B_NibbleLUT[16] = {
+    WS2812B_NIBBLE_SYMBOLS(0x0), WS2812B_NIBBLE_SYMBOLS(0x1), WS2812B_NIBBLE_SYMBOLS(0x2), WS2812B_NIBBLE_SYMBOLS(0x3),
+    WS2812B_NIBBLE_SYMBOLS(0x4), WS2812B_NIBBLE_SYMBOLS(0x5), WS2812B_NIBBLE_SYMBOLS(0x6), WS2812B_NIBBLE_SYMBOLS(0x7),
+    WS2812B_NIBBLE_SYMBOLS(0x8), WS2812B_NIBBLE_SYMBOLS(0x9), WS2812B_NIBBLE_SYMBOLS(0xA), WS2812B_NIBBLE_SYMBOLS(0xB),
+    WS2812B_NIBBLE_SYMBOLS(0xC), WS2812B_NIBBLE_SYMBOLS(0xD), WS2812B_NIBBLE_SYMBOLS(0xE), WS2812B_NIBBLE_SYMBOLS(0xF)
+};
+
+// One color byte -> 24 symbol bits -> 3 bytes
+#define WS2812B_BYTE_LEN 3
+
+static inline void WS2812B_EncodeByte(WS2812B_SPI_Word *symbols, uint8_t value){
+    uint32_t bits = ((uint32_t)WS2812B_NibbleLUT[value >> 4] << 12) | WS2812B_NibbleLUT[value & 0x0F];
+    symbols[0] = (uint8_t)(bits >> 16);
+    symbols[1] = (uint8_t)(bits >> 8);
+    symbols[2] = (uint8_t)bits;
+}
+#else
+// One SPI frame of WS2812B_SPI_SYMBOL_BITS bits per LED bit, 1.3us each at 10MHz
+#define WS2812B_SYMBOL(nibble, bit) (((nibble) & (1 << (bit))) ? WS2812B_SPI_SYMBOL_1 : WS2812B_SPI_SYMBOL_0)
+#define WS2812B_NIBBLE_SYMBOLS(nibble) \
+    {WS2812B_SYMBOL(nibble, 3), WS2812B_SYMBOL(nibble, 2), WS2812B_SYMBOL(nibble, 1), WS2812B_SYMBOL(nibble, 0)}
+
+// Nibble -> 4 symbols, MSB first
+static const uint16_t WS2812B_NibbleLUT[16][4] = {
+    WS2812B_NIBBLE_SYMBOLS(0x0), WS2812B_NIBBLE_SYMBOLS(0x1), WS2812B_NIBBLE_SYMBOLS(0x2), WS2812B_NIBBLE_SYMBOLS(0x3),
+    WS2812B_NIBBLE_SYMBOLS(0x4), WS2812B_NIBBLE_SYMBOLS(0x5), WS2812B_NIBBLE_SYMBOLS(0x6), WS2812B_NIBBLE_SYMBOLS(0x7),
+    WS2812B_NIBBLE_SYMBOLS(0x8), WS2812B_NIBBLE_SYMBOLS(0x9), WS2812B_NIBBLE_SYMBOLS(0xA), WS2812B_NIBBLE_SYMBOLS(0xB),
+    WS2812B_NIBBLE_SYMBOLS(0xC), WS2812B_NIBBLE_SYMBOLS(0xD), WS2812B_NIBBLE_SYMBOLS(0xE), WS2812B_NIBBLE_SYMBOLS(0xF)
+};
+
+// One color byte -> 8 symbols
+#define WS2812B_BYTE_LEN 8
+
+static inline void WS2812B_EncodeByte(WS2812B_SPI_Word *symbols, uint8_t value){
+    const uint16_t *high = WS2812B_NibbleLUT[value >> 4];
+    const uint16_t *low = WS2812B_NibbleLUT[value & 0x0F];
+    symbols[0] = high[0];
+    symbols[1] = high[1];
+    symbols[2] = high[2];
+    symbols[3] = high[3];
+    symbols[4] = low[0];
+    symbols[5] = low[1];
+    symbols[6] = low[2];
+    symbols[7] = low[3];
+}
+#endif
+
+static void WS2812B_SPI_EncodeLED(uint8_t *slot, LED_Color color){
+    WS2812B_SPI_Word *symbols = (WS2812B_SPI_Word *)slot;
+    WS2812B_EncodeByte(&symbols[0], color.G);
+    WS2812B_EncodeByte(&symbols[WS2812B_BYTE_LEN], color.R);
+    WS2812B_EncodeByte(&symbols[2 * WS2812B_BYTE_LEN], color.B);
+#if WS2812B_RGBW
+    WS2812B_EncodeByte(&symbols[3 * WS2812B_BYTE_LEN], color.W);
+#endif
+}
+
+static HAL_StatusTypeDef WS2812B_SPI_Start(WS2812B *strip){
+    return HAL_SPI_Transmit_DMA((SPI_HandleTypeDef *)strip->Handle, (uint8_t *)strip->DMA_Buffer, 2 * WS2812B_SPI_SLOT_LEN);
+}
+
+static void WS2812B_SPI_Stop(WS2812B *strip){
+    HAL_SPI_DMAStop((SPI_HandleTypeDef *)strip->Handle);
+}
+
+static DMA_HandleTypeDef *WS2812B_SPI_GetDMA(WS2812B *strip){
+    return ((SPI_HandleTypeDef *)strip->Handle)->hdmatx;
+}
+
+const WS2812B_Backend WS2812B_SPI_Backend = {
+    .SlotLen = WS2812B_SPI_SLOT_LEN,
+    .SlotBytes = WS2812B_SPI_SLOT_BYTES,
+    .SlotLowUs = WS2812B_SPI_SLOT_LOW_US,
+    .EncodeLED = WS2812B_SPI_EncodeLED,
+    .Start = WS2812B_SPI_Start,
+    .Stop = WS2812B_SPI_Stop,
+    .GetDMA = WS2812B_SPI_GetDMA
+};
+
+/* TIM backend -------------------------------------------------------------*/
+
+// Compare values for the WS2812B_TIM_PERIOD tick PWM period, see WS2812B_Timing.h
+#define WS2812B_TIM_PULSE(nibble, bit) (((nibble) & (1 << (bit))) ? WS2812B_TIM_T1H : WS2812B_TIM_T0H)
+#define WS2812B_TIM_NIBBLE_PULSES(nibble) \
+    ((uint32_t)WS2812B_TIM_PULSE(nibble, 3) | (uint32_t)WS2812B_TIM_PULSE(nibble, 2) << 8 | \
+     (uint32_t)WS2812B_TIM_PULSE(nibble, 1) << 16 | (uint32_t)WS2812B_TIM_PULSE(nibble, 0) << 24)
+
+// Nibble -> 4 compare bytes in transfer order (little endian word)
+static const uint32_t WS2812B_TIM_NibbleLUT[16] = {
+    WS2812B_TIM_NIBBLE_PULSES(0x0), WS2812B_TIM_NIBBLE_PULSES(0x1), WS2812B_TIM_NIBBLE_PULSES(0x2), WS2812B_TIM_NIBBLE_PULSES(0x3),
+    WS2812B_TIM_NIBBLE_PULSES(0x4), WS2812B_TIM_NIBBLE_PULSES(0x5), WS2812B_TIM_NIBBLE_PULSES(0x6), WS2812B_TIM_NIBBLE_PULSES(0x7),
+    WS2812B_TIM_NIBBLE_PULSES(0x8), WS2812B_TIM_NIBBLE_PULSES(0x9), WS2812B_TIM_NIBBLE_PULSES(0xA), WS2812B_TIM_NIBBLE_PULSES(0xB),
+    WS2812B_TIM_NIBBLE_PULSES(0xC), WS2812B_TIM_NIBBLE_PULSES(0xD), WS2812B_TIM_NIBBLE_PULSES(0xE), WS2812B_TIM_NIBBLE_PULSES(0xF)
+};
+
+static void WS2812B_TIM_EncodeLED(uint8_t *slot, LED_Color color){
+    // Slots are 24 or 32 bytes into a word aligned buffer, so word stores are safe
+    uint32_t *pulses = (uint32_t *)slot;
+    pulses[0] = WS2812B_TIM_NibbleLUT[color.G >> 4];
+    pulses[1] = WS2812B_TIM_NibbleLUT[color.G & 0x0F];
+    pulses[2] = WS2812B_TIM_NibbleLUT[color.R >> 4];
+    pulses[3] = WS2812B_TIM_NibbleLUT[color.R & 0x0F];
+    pulses[4] = WS2812B_TIM_NibbleLUT[color.B >> 4];
+    pulses[5] = WS2812B_TIM_NibbleLUT[color.B & 0x0F];
+#if WS2812B_RGBW
+    pulses[6] = WS2812B_TIM_NibbleLUT[color.W >> 4];
+    pulses[7] = WS2812B_TIM_NibbleLUT[color.W & 0x0F];
+#endif
+}
+
+static HAL_StatusTypeDef WS2812B_TIM_Start(WS2812B *strip){
+    return HAL_TIM_PWM_Start_DMA((TIM_HandleTypeDef *)strip->Handle, strip->Channel, strip->DMA_Buffer, 2 * WS2812B_TIM_SLOT_LEN);
+}
+
+static void WS2812B_TIM_Stop(WS2812B *strip){
+    HAL_TIM_PWM_Stop_DMA((TIM_HandleTypeDef *)strip->Handle, strip->Channel);
+}
+
+static DMA_HandleTypeDef *WS2812B_TIM_GetDMA(WS2812B *strip){
+    return ((TIM_HandleTypeDef *)strip->Handle)->hdma[TIM_DMA_ID_CC1 + (strip->Channel >> 2)];
+}
+
+const WS2812B_Backend WS2812B_TIM_Backend = {
+    .SlotLen = WS2812B_TIM_SLOT_LEN,
+    .SlotBytes = WS2812B_TIM_SLOT_BYTES,
+    .SlotLowUs = WS2812B_TIM_SLOT_LOW_US,
+    .EncodeLED = WS2812B_TIM_EncodeLED,
+    .Start = WS2812B_TIM_Start,
+    .Stop = WS2812B_TIM_Stop,
+    .GetDMA = WS2812B_TIM_GetDMA
+};
+
+/* Color correction --------------------------------------------------------*/
+
+#if WS2812B_GAMMA_CORRECTION
+// round(255 * (i / 255) ^ 2.2)
+static const uint8_t WS2812B_GammaLUT[256] = {
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   1,
+      1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,
+      3,   3,   3,   3,   3,   4,   4,   4,   4,   5,   5,   5,   5,   6,   6,   6,
+      6,   7,   7,   7,   8,   8,   8,   9,   9,   9,  10,  10,  11,  11,  11,  12,
+     12,  13,  13,  13,  14,  14,  15,  15,  16,  16,  17,  17,  18,  18,  19,  19,
+     20,  20,  21,  22,  22,  23,  23,  24,  25,  25,  26,  26,  27,  28,  28,  29,
+     30,  30,  31,  32,  33,  33,  34,  35,  35,  36,  37,  38,  39,  39,  40,  41,
+     42,  43,  43,  44,  45,  46,  47,  48,  49,  49,  50,  51,  52,  53,  54,  55,
+     56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,
+     73,  74,  75,  76,  77,  78,  79,  81,  82,  83,  84,  85,  87,  88,  89,  90,
+     91,  93,  94,  95,  97,  98,  99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+    113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+    137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+    163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+    192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+    223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255
+};
+#endif
+
+// Only called at frame start, while no transfer is reading the table
+static void WS2812B_BuildLUT(WS2812B *strip, uint8_t level){
+    uint16_t brightness = level;
+    for(uint16_t i = 0; i < 256; i++){
+#if WS2812B_GAMMA_CORRECTION
+        uint16_t value = WS2812B_GammaLUT[i];
+#else
+        uint16_t value = i;
+#endif
+        // value * brightness / 255 rounded, without a division (Cortex-M0 has no divider)
+        uint16_t scaled = value * brightness + 128;
+        strip->ColorLUT[i] = (scaled + (scaled >> 8)) >> 8;
+    }
+    strip->OutputLevel = level;
+    strip->LUT_Stale = 0;
+}
+
+static uint16_t WS2812B_Intensity(LED_Color color){
+#if WS2812B_GAMMA_CORRECTION
+    uint16_t sum = WS2812B_GammaLUT[color.G] + WS2812B_GammaLUT[color.R] + WS2812B_GammaLUT[color.B];
+#if WS2812B_RGBW
+    sum += WS2812B_GammaLUT[color.W];
+#endif
+#else
+    uint16_t sum = color.G + color.R + color.B;
+#if WS2812B_RGBW
+    sum += color.W;
+#endif
+#endif
+    return sum;
+}
+
+/* Brightness the front buffer can be sent with without exceeding the current limit.
+ * Runs at every frame start: one multiply when within budget, otherwise the largest level fitting
+ * the budget is built bit by bit, 8 multiplies and no division (Cortex-M0 has no divider). */
+static uint8_t WS2812B_LimitedLevel(WS2812B *strip){
+    uint32_t intensity = strip->FrontIntensity;
+    if(strip->CurrentLimit_mA == 0 || intensity * strip->Brightness <= strip->LevelBudget){
+        return strip->Brightness;
+    }
+    uint8_t level = 0;
+    for(uint8_t bit = 0x80; bit != 0; bit >>= 1){
+        if((level | bit) * intensity <= strip->LevelBudget){
+            level |= bit;
+        }
+    }
+    return level;
+}
+
+/* Scheduler ---------------------------------------------------------------*/
+
+static WS2812B_Result WS2812B_StartFrame(WS2812B *strip);
+
+// Another strip streams through the same DMA channel right now
+static uint8_t WS2812B_DMAInUse(WS2812B *strip){
+    for(uint8_t i = 0; i < WS2812B_StripNum; i++){
+        WS2812B *other = WS2812B_Strips[i];
+        if(other != strip && other->DMA == strip->DMA &&
+           (other->Status == WS2812B_Buffering || other->Status == WS2812B_Transmitting || other->Status == WS2812B_Refreshing)){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Claim the DMA channel for the strip or queue it behind the current user, interrupts must be masked
+static uint8_t WS2812B_Claim(WS2812B *strip){
+    if(WS2812B_Held || WS2812B_DMAInUse(strip)){
+        strip->Status = WS2812B_Queued;
+        return 0;
     }
     strip->Status = WS2812B_Buffering;
+    return 1;
+}
 
-    uint16_t DMA_Buffer[WS2812B_MAX_LED_NUM * 24] = {0};
-    uint16_t *buffer_ptr = DMA_Buffer;
-    for(uint8_t led_count = 0; led_count < strip->LED_Num; led_count++){
-        for(uint8_t greenBit = 0; greenBit < 8; greenBit++){
-            *buffer_ptr = (strip->LEDs[led_count].G & (1 << (7 - greenBit))) ? 0b111111000 : 0b111000000;
-            buffer_ptr++;
+// The strip no longer streams, hand its DMA channel to the next queued strip
+static void WS2812B_ReleaseDMA(WS2812B *strip){
+    uint8_t self = 0;
+    while(self < WS2812B_StripNum && WS2812B_Strips[self] != strip){
+        self++;
+    }
+    WS2812B *next = NULL;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    // Search from the strip after this one so strips sharing a channel take turns
+    for(uint8_t n = 1; n < WS2812B_StripNum; n++){
+        WS2812B *candidate = WS2812B_Strips[(self + n) % WS2812B_StripNum];
+        if(candidate->DMA == strip->DMA && candidate->Status == WS2812B_Queued){
+            candidate->Status = WS2812B_Buffering;
+            next = candidate;
+            break;
+        }
+    }
+    __set_PRIMASK(primask);
+
+    if(next != NULL){
+        WS2812B_StartFrame(next);
+    }
+}
+
+WS2812B *WS2812B_FindSPI(SPI_HandleTypeDef *hspi){
+    for(uint8_t i = 0; i < WS2812B_StripNum; i++){
+        if(WS2812B_Strips[i]->Handle == hspi){
+            return WS2812B_Strips[i];
+        }
+    }
+    return NULL;
+}
+
+// Strip of the channel reported active by the HAL, several strips may share one timer
+WS2812B *WS2812B_FindTIM(TIM_HandleTypeDef *htim){
+    for(uint8_t i = 0; i < WS2812B_StripNum; i++){
+        WS2812B *strip = WS2812B_Strips[i];
+        if(strip->Handle == htim && WS2812B_ACTIVE_CHANNEL(strip->Channel) == htim->Channel){
+            return strip;
+        }
+    }
+    return NULL;
+}
+
+WS2812B *WS2812B_FindLatch(TIM_HandleTypeDef *htim){
+    for(uint8_t i = 0; i < WS2812B_StripNum; i++){
+        WS2812B *strip = WS2812B_Strips[i];
+        if(strip->LatchTimer == htim && WS2812B_ACTIVE_CHANNEL(strip->LatchChannel) == htim->Channel){
+            return strip;
         }
-        for(uint8_t redBit = 0; redBit < 8; redBit++){
-            *buffer_ptr = (strip->LEDs[led_count].R & (1 << (7 - redBit))) ? 0b111111000 : 0b111000000;
-            buffer_ptr++;
+    }
+    return NULL;
+}
+
+/* Keep every strip from starting a frame, e.g. while a flash write stalls the CPU and would hold off
+ * the DMA refills. Returns 0 while some strip is still streaming, nothing is held then. */
+uint8_t WS2812B_Hold(void){
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for(uint8_t i = 0; i < WS2812B_StripNum; i++){
+        WS2812B_Status status = WS2812B_Strips[i]->Status;
+        if(status != WS2812B_Idle && status != WS2812B_Latching && status != WS2812B_Queued){
+            __set_PRIMASK(primask);
+            return 0;
         }
-        for(uint8_t blueBit = 0; blueBit < 8; blueBit++){
-            *buffer_ptr = (strip->LEDs[led_count].B & (1 << (7 - blueBit))) ? 0b111111000 : 0b111000000;
-            buffer_ptr++;
+    }
+    WS2812B_Held = 1;
+    __set_PRIMASK(primask);
+    return 1;
+}
+
+// Let the strips stream again and start the frames requested while they were held
+void WS2812B_Resume(void){
+    WS2812B_Held = 0;
+    for(uint8_t i = 0; i < WS2812B_StripNum; i++){
+        WS2812B *strip = WS2812B_Strips[i];
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        uint8_t claimed = (strip->Status == WS2812B_Queued) && WS2812B_Claim(strip);
+        __set_PRIMASK(primask);
+        if(claimed){
+            WS2812B_StartFrame(strip);
         }
     }
+}
+
+/* Streaming ---------------------------------------------------------------*/
+
+static inline uint8_t *WS2812B_Slot(WS2812B *strip, uint8_t slotIndex){
+    return (uint8_t *)strip->DMA_Buffer + slotIndex * strip->Backend->SlotBytes;
+}
+
+static void WS2812B_FillSlot(WS2812B *strip, uint8_t slotIndex){
+    uint8_t *slot = WS2812B_Slot(strip, slotIndex);
+    uint16_t led = strip->NextSlot++;
+    if(led >= strip->SendNum){
+        // Past the end of the strip, keep the line low
+        if(strip->SlotState[slotIndex] != WS2812B_SlotZero){
+            for(uint8_t i = 0; i < strip->Backend->SlotBytes; i++){
+                slot[i] = 0;
+            }
+            strip->SlotState[slotIndex] = WS2812B_SlotZero;
+        }
+        return;
+    }
+    LED_Color color = WS2812B_FrameColor(strip, strip->Front, led);
+    color.G = strip->ColorLUT[color.G];
+    color.R = strip->ColorLUT[color.R];
+    color.B = strip->ColorLUT[color.B];
+#if WS2812B_RGBW
+    color.W = strip->ColorLUT[color.W];
+#endif
+    // Inside a run of one color the slot already holds these symbols, DMA just sends it again
+    if(strip->SlotState[slotIndex] == WS2812B_SlotColor && WS2812B_SameColor(strip->SlotColor[slotIndex], color)){
+        return;
+    }
+    strip->Backend->EncodeLED(slot, color);
+    strip->SlotColor[slotIndex] = color;
+    strip->SlotState[slotIndex] = WS2812B_SlotColor;
+}
 
-    HAL_SPI_Transmit_DMA(&hspi1, (uint8_t *)DMA_Buffer, strip->LED_Num * 24);
+// Encode the first two slots and start the circular transfer, Status must already be Buffering
+static WS2812B_Result WS2812B_StartFrame(WS2812B *strip){
+    if(strip->SendEnd == 0){
+        // Nothing changed since the last refresh
+        strip->Status = WS2812B_Idle;
+        WS2812B_ReleaseDMA(strip);
+        return WS2812B_OK;
+    }
+
+    uint8_t level = WS2812B_LimitedLevel(strip);
+    if(strip->LUT_Stale || level != strip->OutputLevel){
+        WS2812B_BuildLUT(strip, level);
+        // A new output level changes every LED, not just the committed ones
+        strip->SendEnd = strip->LED_Num;
+    }
+
+    // LEDs past the last changed one keep their latched color, only send the prefix
+    strip->SendNum = (strip->SendEnd < strip->LED_Num) ? strip->SendEnd : strip->LED_Num;
+    strip->SendEnd = 0;
+    strip->NextSlot = 0;
+    WS2812B_FillSlot(strip, 0);
+    WS2812B_FillSlot(strip, 1);
+
+    // DMA runs in circular mode, the slots are refilled from WS2812B_DMA_HalfIT / WS2812B_DMA_IT
     strip->Status = WS2812B_Transmitting;
+    if(HAL_OK != strip->Backend->Start(strip)){
+        strip->Status = WS2812B_Idle;
+        WS2812B_ReleaseDMA(strip);
+        return WS2812B_Error;
+    }
     return WS2812B_OK;
 }
 
-WS2812B_Result WS2812B_DMA_IT(WS2812B *strip){
+// Publish the back buffer: swap it with the front buffer and refresh the strip.
+// Returns WS2812B_Busy while a frame is being encoded from the front buffer.
+// A single buffered strip has nothing to swap, the refresh is requested (or coalesced) right away.
+WS2812B_Result WS2812B_Commit(WS2812B *strip){
     if(strip == NULL){
         return WS2812B_Error;
     }
 
-    if(strip->Status == WS2812B_Transmitting){
-        uint16_t DMA_Buffer[5] = {0};
-        if(HAL_OK != HAL_SPI_Transmit_DMA(&hspi1, (uint8_t *)DMA_Buffer, sizeof(DMA_Buffer))){
-            return WS2812B_Error;
+    uint8_t doubleBuffered = (strip->Front != strip->Back);
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if(doubleBuffered){
+        if(strip->Status == WS2812B_Buffering || strip->Status == WS2812B_Transmitting || strip->Status == WS2812B_Refreshing){
+            __set_PRIMASK(primask);
+            return WS2812B_Busy;
         }
-        strip->Status = WS2812B_Refreshing;
-        return WS2812B_OK; 
-    }else if(strip->Status == WS2812B_Refreshing){
-        strip->Status = WS2812B_Idle;
+        WS2812B_Pixel *front = strip->Back;
+        strip->Back = strip->Front;
+        strip->Front = front;
+    }
+    uint16_t changed = strip->DirtyEnd;
+    if(changed > strip->SendEnd){
+        strip->SendEnd = changed;
+    }
+    strip->FrontIntensity = strip->IntensitySum;
+    strip->DirtyEnd = 0;
+#if WS2812B_PALETTE_BITS
+    // Front is what Back was, entries Back stopped using are unused by both now
+    memset(strip->PaletteFreed, 0, sizeof(strip->PaletteFreed));
+#endif
+    __set_PRIMASK(primask);
+
+    // The new back buffer is the old front, only its changed prefix is out of date
+    if(doubleBuffered){
+        memcpy(strip->Back, strip->Front, WS2812B_FRAME_BYTES(changed));
+    }
+    return WS2812B_StartRefresh(strip);
+}
+
+WS2812B_Result WS2812B_StartRefresh(WS2812B *strip){
+    if(strip == NULL){
+        return WS2812B_Error;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    strip->RequestedFrames++;
+    if(strip->Status == WS2812B_Queued){
+        // Not encoded yet, the queued frame will carry this change too
+        strip->CoalescedFrames++;
+        __set_PRIMASK(primask);
         return WS2812B_OK;
-    }else{
+    }
+    if(strip->Status != WS2812B_Idle){
+        // Busy, merge into the one follow-up frame started once this one is latched
+        if(strip->RefreshPending){
+            strip->CoalescedFrames++;
+        }
+        strip->RefreshPending = 1;
+        __set_PRIMASK(primask);
+        return WS2812B_OK;
+    }
+    uint8_t claimed = WS2812B_Claim(strip);
+    __set_PRIMASK(primask);
+
+    // A queued strip is started by WS2812B_ReleaseDMA of the strip ahead of it
+    return claimed ? WS2812B_StartFrame(strip) : WS2812B_OK;
+}
+
+/* Time the rest of the reset window with a one-shot compare, the output is idle meanwhile.
+ * LatchTimer free runs and its update is the effect tick: only the compare interrupt is armed and
+ * disarmed here, HAL_TIM_OC_Stop_IT would stop the counter once no channel is enabled. */
+static void WS2812B_StartLatch(WS2812B *strip){
+    TIM_HandleTypeDef *htim = strip->LatchTimer;
+    uint32_t period = __HAL_TIM_GET_AUTORELOAD(htim) + 1;
+    uint32_t expiry = (__HAL_TIM_GET_COUNTER(htim) + WS2812B_RESET_US - strip->Backend->SlotLowUs) % period;
+
+    __HAL_TIM_SET_COMPARE(htim, strip->LatchChannel, expiry);
+    // The compare flag is set on every match, drop the stale one before enabling the interrupt
+    __HAL_TIM_CLEAR_FLAG(htim, TIM_FLAG_CC1 << (strip->LatchChannel >> 2));
+    __HAL_TIM_ENABLE_IT(htim, WS2812B_LATCH_IT(strip->LatchChannel));
+}
+
+static WS2812B_Result WS2812B_SlotSent(WS2812B *strip, uint8_t slotIndex){
+    if(strip->Status != WS2812B_Transmitting && strip->Status != WS2812B_Refreshing){
         return WS2812B_Error;
     }
+
+    // Every interrupt means one more slot went out on the wire
+    uint16_t sentSlots = strip->NextSlot - 1;
+    if(sentSlots > strip->SendNum){
+        // The zero slot behind the data is out, the line is low: release the DMA and time the latch
+        strip->Backend->Stop(strip);
+        strip->Status = WS2812B_Latching;
+        WS2812B_StartLatch(strip);
+        WS2812B_ReleaseDMA(strip);
+        return WS2812B_OK;
+    }
+    if(sentSlots == strip->SendNum){
+        strip->Status = WS2812B_Refreshing;
+    }
+    WS2812B_FillSlot(strip, slotIndex);
+    return WS2812B_OK;
 }
 
+WS2812B_Result WS2812B_DMA_HalfIT(WS2812B *strip){
+    if(strip == NULL){
+        return WS2812B_Error;
+    }
+    return WS2812B_SlotSent(strip, 0);
+}
+
+WS2812B_Result WS2812B_DMA_IT(WS2812B *strip){
+    if(strip == NULL){
+        return WS2812B_Error;
+    }
+    return WS2812B_SlotSent(strip, 1);
+}
+
+WS2812B_Result WS2812B_LatchIT(WS2812B *strip){
+    if(strip == NULL || strip->Status != WS2812B_Latching){
+        return WS2812B_Error;
+    }
+    __HAL_TIM_DISABLE_IT(strip->LatchTimer, WS2812B_LATCH_IT(strip->LatchChannel));
+
+    // Reset window over, the strip accepts the next frame from here
+    strip->TransmittedFrames++;
+    if(strip->RefreshPending){
+        strip->RefreshPending = 0;
+        return WS2812B_Claim(strip) ? WS2812B_StartFrame(strip) : WS2812B_OK;
+    }
+    strip->Status = WS2812B_Idle;
+    return WS2812B_OK;
+}
\ No newline at end of file
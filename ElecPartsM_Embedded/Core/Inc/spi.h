@@ -29,7 +29,7 @@ extern "C" {
 #include "main.h"
 
 /* USER CODE BEGIN Includes */
-
+#include "WS2812B_Timing.h"
 /* USER CODE END Includes */
 
 extern SPI_HandleTypeDef hspi1;
@@ -52,7 +52,9 @@ void SVC_Handler(void);
 void PendSV_Handler(void);
 void SysTick_Handler(void);
 void DMA1_Channel2_3_IRQHandler(void);
+void DMA1_Channel4_5_IRQHandler(void);
 void TIM1_BRK_UP_TRG_COM_IRQHandler(void);
+void TIM1_CC_IRQHandler(void);
 void TIM3_IRQHandler(void);
 void USART1_IRQHandler(void);
 void USART2_IRQHandler(void);
@@ -43,6 +43,8 @@ extern TIM_HandleTypeDef htim3;
 void MX_TIM1_Init(void);
 void MX_TIM3_Init(void);
 
+void HAL_TIM_MspPostInit(TIM_HandleTypeDef *htim);
+
 /* USER CODE BEGIN Prototypes */
 
 /* USER CODE END Prototypes */
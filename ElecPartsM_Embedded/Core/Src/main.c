@@ -28,6 +28,11 @@
 /* USER CODE BEGIN Includes */
 #include "WS2812B_Driver.h"
 #include "UnitCommute.h"
+#include "LED_Effect.h"
+#include "LED_Animation.h"
+#include "LED_Highlight.h"
+#include "LED_Layer.h"
+#include "UC_Port.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -37,7 +42,9 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
-
+// LEDs on each shelf row, the framebuffers below are sized by them
+#define LED_ROW0_NUM 8
+#define LED_ROW1_NUM 8
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -48,15 +55,55 @@
 /* Private variables ---------------------------------------------------------*/
 
 /* USER CODE BEGIN PV */
-WS2812B ledStrip = {
-    .LED_Num = 8,
+/* Framebuffers of each row. RAM is 8KB on the F030C8: with a 1KB stack and about 4.4KB for the
+ * rest of the application, the LED modules of each row taking about 1.1KB of it, roughly 2.5KB
+ * are left for frames. A double buffered LED costs 2 * WS2812B_FRAME_BYTES(1) plus its layer base
+ * color (9 bytes), about 280 LEDs over all rows. Rows too long for that run single buffered with
+ * Frames[1] NULL and save 3 bytes per LED. */
+static WS2812B_Pixel ledRow0Frames[2][WS2812B_FRAME_LEN(LED_ROW0_NUM)];
+static WS2812B_Pixel ledRow1Frames[2][WS2812B_FRAME_LEN(LED_ROW1_NUM)];
+
+// Shelf rows of the unit, streamed concurrently on their own DMA channels
+WS2812B ledStrips[WS2812B_MAX_STRIP_NUM] = {
+  {
+    .LED_Num = LED_ROW0_NUM,
+    .Frames = {ledRow0Frames[0], ledRow0Frames[1]},
+    .Status = WS2812B_Idle,
+    .Backend = &WS2812B_SPI_Backend,
+    .Handle = &hspi1,
+    .LatchTimer = &htim1,
+    .LatchChannel = TIM_CHANNEL_1,
+    .Brightness = 255,
+    .CurrentLimit_mA = 1000
+  },
+  {
+    .LED_Num = LED_ROW1_NUM,
+    .Frames = {ledRow1Frames[0], ledRow1Frames[1]},
     .Status = WS2812B_Idle,
-    .LEDs = {0}
+    .Backend = &WS2812B_TIM_Backend,
+    .Handle = &htim3,
+    .Channel = TIM_CHANNEL_1,
+    .LatchTimer = &htim1,
+    .LatchChannel = TIM_CHANNEL_2,
+    .Brightness = 255,
+    .CurrentLimit_mA = 1000
+  }
+};
+// LED modules of each row, the UnitCommute LED commands pick one by their strip byte
+LED_Effects ledEffects[WS2812B_MAX_STRIP_NUM];
+LED_Animation ledAnimation[WS2812B_MAX_STRIP_NUM];
+LED_Highlights ledHighlights[WS2812B_MAX_STRIP_NUM];
+LED_Layers ledLayers[WS2812B_MAX_STRIP_NUM];
+static LED_Color ledRow0Base[LED_ROW0_NUM];
+static LED_Color ledRow1Base[LED_ROW1_NUM];
+static LED_Color *const ledLayerBase[WS2812B_MAX_STRIP_NUM] = {ledRow0Base, ledRow1Base};
+
+// Chain UARTs. USART2 receives through circular DMA and sends by interrupt (its TX channel feeds TIM3),
+// USART1 receives by interrupt (its RX channel feeds SPI1) and sends through DMA
+UC_Port ucPorts[UC_PORT_NUM] = {
+  {.Handle = &huart1},
+  {.Handle = &huart2}
 };
-
-extern uint8_t Uart_ByteReceiveDirection;
-extern uint8_t UC_FrameBuf[UC_FRAME_MAX_SIZE];
-extern uint8_t RxBuf;
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -106,29 +153,44 @@ int main(void)
   MX_TIM1_Init();
   MX_TIM3_Init();
   /* USER CODE BEGIN 2 */
-
+  // TIM1 free runs at 1MHz as the WS2812B latch timebase, its update is the effect tick
+  for(uint8_t i = 0; i < WS2812B_MAX_STRIP_NUM; i++){
+    WS2812B_Init(&ledStrips[i]);
+    // Effects, animation and highlights draw beneath the layers, which alone write the strip
+    LED_Layer_Init(&ledLayers[i], &ledStrips[i], ledLayerBase[i]);
+    LED_Effect_Init(&ledEffects[i], &ledLayers[i]);
+    LED_Animation_Init(&ledAnimation[i], &ledLayers[i]);
+    LED_Highlight_Init(&ledHighlights[i], &ledLayers[i]);
+  }
+  for(uint8_t i = 0; i < UC_PORT_NUM; i++){
+    UC_Port_Init(&ucPorts[i]);
+  }
+  HAL_TIM_Base_Start_IT(&htim1);
   /* USER CODE END 2 */
 
   /* Infinite loop */
   /* USER CODE BEGIN WHILE */
   while (1)
   {
-    if(Uart_ByteReceiveDirection != 0){
-      static uint8_t lastReceiveDirection = 0, receiveCount = 0;
-      if(receiveCount == 0){
-        lastReceiveDirection = Uart_ByteReceiveDirection;
-      }
-      if(Uart_ByteReceiveDirection == lastReceiveDirection && receiveCount < UC_FRAME_MAX_SIZE){
-        if(RxBuf == '\n'){
-          ProcessUC_Frame(receiveCount);
-          receiveCount = 0;
-        }else{
-          UC_FrameBuf[receiveCount++] = RxBuf;
-        } 
-      }else{
-        receiveCount = 0;
+    for(uint8_t port = 0; port < UC_PORT_NUM; port++){
+      // Take everything the port received since the last pass in one go
+      uint8_t rxData[UC_PORT_RX_SIZE];
+      uint8_t rxLost;
+      uint16_t rxLength = UC_Port_Read(&ucPorts[port], rxData, sizeof(rxData), &rxLost);
+      if(rxLost){
+        // Bytes went missing before these, skip to the next frame
+        UC_Resync(port + 1);
       }
-      Uart_ByteReceiveDirection = 0;
+      // Each port assembles its own frames, traffic on the other one does not disturb it
+      UC_Receive(port + 1, rxData, rxLength);
+    }
+    UC_Process();
+    for(uint8_t i = 0; i < WS2812B_MAX_STRIP_NUM; i++){
+      LED_Effect_Process(&ledEffects[i]);
+      LED_Animation_Process(&ledAnimation[i]);
+      LED_Highlight_Process(&ledHighlights[i]);
+      // Composite what the pass drew and commit it in one frame
+      LED_Layer_Process(&ledLayers[i]);
     }
     /* USER CODE END WHILE */
     /* USER CODE BEGIN 3 */
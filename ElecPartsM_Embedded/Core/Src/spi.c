@@ -41,7 +41,7 @@ void MX_SPI1_Init(void)
   hspi1.Instance = SPI1;
   hspi1.Init.Mode = SPI_MODE_MASTER;
   hspi1.Init.Direction = SPI_DIRECTION_2LINES;
-  hspi1.Init.DataSize = SPI_DATASIZE_9BIT;
+  hspi1.Init.DataSize = SPI_DATASIZE_13BIT;
   hspi1.Init.CLKPolarity = SPI_POLARITY_LOW;
   hspi1.Init.CLKPhase = SPI_PHASE_1EDGE;
   hspi1.Init.NSS = SPI_NSS_SOFT;
@@ -57,6 +57,16 @@ void MX_SPI1_Init(void)
     Error_Handler();
   }
   /* USER CODE BEGIN SPI1_Init 2 */
+  // Frame size and bit rate come from the LED timing profile (WS2812B_Timing.h)
+  if (hspi1.Init.DataSize != WS2812B_SPI_DATASIZE || hspi1.Init.BaudRatePrescaler != WS2812B_SPI_BAUDRATEPRESCALER)
+  {
+    hspi1.Init.DataSize = WS2812B_SPI_DATASIZE;
+    hspi1.Init.BaudRatePrescaler = WS2812B_SPI_BAUDRATEPRESCALER;
+    if (HAL_SPI_Init(&hspi1) != HAL_OK)
+    {
+      Error_Handler();
+    }
+  }
 
   /* USER CODE END SPI1_Init 2 */
 
@@ -102,7 +112,7 @@ void HAL_SPI_MspInit(SPI_HandleTypeDef* spiHandle)
     hdma_spi1_tx.Init.MemInc = DMA_MINC_ENABLE;
     hdma_spi1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
     hdma_spi1_tx.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
-    hdma_spi1_tx.Init.Mode = DMA_NORMAL;
+    hdma_spi1_tx.Init.Mode = DMA_CIRCULAR;
     hdma_spi1_tx.Init.Priority = DMA_PRIORITY_MEDIUM;
     if (HAL_DMA_Init(&hdma_spi1_tx) != HAL_OK)
     {
@@ -112,6 +122,14 @@ void HAL_SPI_MspInit(SPI_HandleTypeDef* spiHandle)
     __HAL_LINKDMA(spiHandle,hdmatx,hdma_spi1_tx);
 
   /* USER CODE BEGIN SPI1_MspInit 1 */
+#if WS2812B_SPI_3BIT_SYMBOLS
+    hdma_spi1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma_spi1_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    if (HAL_DMA_Init(&hdma_spi1_tx) != HAL_OK)
+    {
+      Error_Handler();
+    }
+#endif
 
   /* USER CODE END SPI1_MspInit 1 */
   }
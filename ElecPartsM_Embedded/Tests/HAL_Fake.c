@@ -0,0 +1,205 @@
+#include "HAL_Fake.h"
+#include "spi.h"
+#include "tim.h"
+#include "usart.h"
+#include <string.h>
+
+DMA_HandleTypeDef Fake_SPI_DMA;
+DMA_HandleTypeDef Fake_TIM_DMA;
+uint16_t Fake_SPI_Items;
+uint16_t Fake_TIM_Items;
+
+// TIM1 free runs from main, its update interrupt is the effect tick
+static TIM_TypeDef Fake_TIM1 = {.CR1 = TIM_CR1_CEN, .ARR = 0xFFFF};
+static TIM_TypeDef Fake_TIM3;
+
+DMA_HandleTypeDef Fake_UART1_TxDMA;
+DMA_HandleTypeDef Fake_UART2_RxDMA;
+
+SPI_HandleTypeDef hspi1 = {.hdmatx = &Fake_SPI_DMA};
+TIM_HandleTypeDef htim1 = {.Instance = &Fake_TIM1};
+TIM_HandleTypeDef htim3 = {.Instance = &Fake_TIM3, .hdma = {[TIM_DMA_ID_CC1] = &Fake_TIM_DMA}};
+// Wired like main: USART1 receives by interrupt and sends through DMA, USART2 the other way round
+UART_HandleTypeDef huart1 = {.hdmatx = &Fake_UART1_TxDMA, .gState = HAL_UART_STATE_READY, .RxState = HAL_UART_STATE_READY};
+UART_HandleTypeDef huart2 = {.hdmarx = &Fake_UART2_RxDMA, .gState = HAL_UART_STATE_READY, .RxState = HAL_UART_STATE_READY};
+
+// The driver refuses to start when the clock differs from the one its symbols were built for
+uint32_t HAL_RCC_GetPCLK1Freq(void){
+    return (uint32_t)WS2812B_PCLK_HZ;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size){
+    if(pData == NULL || Size == 0 || hspi->hdmatx->Running){
+        return HAL_BUSY;
+    }
+    hspi->hdmatx->Running = 1;
+    Fake_SPI_Items = Size;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_DMAStop(SPI_HandleTypeDef *hspi){
+    hspi->hdmatx->Running = 0;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Start_DMA(TIM_HandleTypeDef *htim, uint32_t Channel, const uint32_t *pData, uint16_t Length){
+    DMA_HandleTypeDef *dma = htim->hdma[TIM_DMA_ID_CC1 + (Channel >> 2)];
+    if(pData == NULL || Length == 0 || dma->Running){
+        return HAL_BUSY;
+    }
+    dma->Running = 1;
+    Fake_TIM_Items = Length;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Stop_DMA(TIM_HandleTypeDef *htim, uint32_t Channel){
+    htim->hdma[TIM_DMA_ID_CC1 + (Channel >> 2)]->Running = 0;
+    return HAL_OK;
+}
+
+// Like the HAL: start enables the channel and the counter
+HAL_StatusTypeDef HAL_TIM_OC_Start_IT(TIM_HandleTypeDef *htim, uint32_t Channel){
+    htim->Instance->DIER |= TIM_IT_CC1 << (Channel >> 2);
+    htim->Instance->CCER |= TIM_CCER_CC1E << Channel;
+    htim->Instance->CR1 |= TIM_CR1_CEN;
+    return HAL_OK;
+}
+
+// Like the HAL: __HAL_TIM_DISABLE stops the counter once no channel is left enabled
+HAL_StatusTypeDef HAL_TIM_OC_Stop_IT(TIM_HandleTypeDef *htim, uint32_t Channel){
+    htim->Instance->DIER &= ~(TIM_IT_CC1 << (Channel >> 2));
+    htim->Instance->CCER &= ~(TIM_CCER_CC1E << Channel);
+    if((htim->Instance->CCER & 0x1111U) == 0){
+        htim->Instance->CR1 &= ~TIM_CR1_CEN;
+    }
+    return HAL_OK;
+}
+
+/* UART --------------------------------------------------------------------*/
+
+// Like the HAL: circular DMA reception keeps running across idle events
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size){
+    if(pData == NULL || Size == 0 || huart->RxState != HAL_UART_STATE_READY){
+        return HAL_BUSY;
+    }
+    huart->pRxBuffPtr = pData;
+    huart->RxXferSize = Size;
+    huart->hdmarx->Counter = Size;
+    huart->hdmarx->Running = 1;
+    huart->RxState = HAL_UART_STATE_BUSY_RX;
+    return HAL_OK;
+}
+
+// Like the HAL: interrupt reception ends at the idle line or once Size bytes arrived
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size){
+    if(pData == NULL || Size == 0 || huart->RxState != HAL_UART_STATE_READY){
+        return HAL_BUSY;
+    }
+    huart->pRxBuffPtr = pData;
+    huart->RxXferSize = Size;
+    huart->RxXferCount = Size;
+    huart->RxState = HAL_UART_STATE_BUSY_RX;
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef Fake_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size){
+    if(pData == NULL || Size == 0 || huart->gState != HAL_UART_STATE_READY){
+        return HAL_BUSY;
+    }
+    huart->pTxBuffPtr = pData;
+    huart->TxXferSize = Size;
+    huart->gState = HAL_UART_STATE_BUSY_TX;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size){
+    return Fake_UART_Transmit(huart, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size){
+    return Fake_UART_Transmit(huart, pData, Size);
+}
+
+// Overridden by the tests routing the UART events, like the HAL's __weak ones
+__attribute__((weak)) void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size){
+    (void)huart;
+    (void)Size;
+}
+
+__attribute__((weak)) void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart){
+    (void)huart;
+}
+
+/* Bytes arriving on the line, with the reception events the HAL raises for them: half and full
+ * ring for circular DMA, a full buffer for interrupt reception, and the idle line after the last
+ * byte. Bytes arriving while no reception runs are lost. */
+void Fake_UART_Receive(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size){
+    for(uint16_t i = 0; i < size; i++){
+        if(huart->RxState != HAL_UART_STATE_BUSY_RX){
+            continue;
+        }
+        if(huart->hdmarx != NULL){
+            huart->pRxBuffPtr[huart->RxXferSize - huart->hdmarx->Counter] = data[i];
+            if(--huart->hdmarx->Counter == 0){
+                huart->hdmarx->Counter = huart->RxXferSize;
+                HAL_UARTEx_RxEventCallback(huart, huart->RxXferSize);
+            }else if(huart->hdmarx->Counter == huart->RxXferSize / 2){
+                HAL_UARTEx_RxEventCallback(huart, huart->RxXferSize / 2);
+            }
+        }else{
+            huart->pRxBuffPtr[huart->RxXferSize - huart->RxXferCount] = data[i];
+            if(--huart->RxXferCount == 0){
+                huart->RxState = HAL_UART_STATE_READY;
+                HAL_UARTEx_RxEventCallback(huart, huart->RxXferSize);
+            }
+        }
+    }
+    if(size == 0 || huart->RxState != HAL_UART_STATE_BUSY_RX){
+        return;
+    }
+    // Idle line
+    if(huart->hdmarx != NULL){
+        uint16_t position = huart->RxXferSize - huart->hdmarx->Counter;
+        if(position != 0 && position != huart->RxXferSize / 2){
+            HAL_UARTEx_RxEventCallback(huart, position);
+        }
+    }else if(huart->RxXferCount != huart->RxXferSize){
+        huart->RxState = HAL_UART_STATE_READY;
+        HAL_UARTEx_RxEventCallback(huart, huart->RxXferSize - huart->RxXferCount);
+    }
+}
+
+// Finish the running transmission: copy its bytes to out, raise the completion. Returns the bytes sent.
+uint16_t Fake_UART_Send(UART_HandleTypeDef *huart, uint8_t *out){
+    if(huart->gState != HAL_UART_STATE_BUSY_TX){
+        return 0;
+    }
+    uint16_t size = huart->TxXferSize;
+    memcpy(out, huart->pTxBuffPtr, size);
+    huart->gState = HAL_UART_STATE_READY;
+    HAL_UART_TxCpltCallback(huart);
+    return size;
+}
+
+/* Flash -------------------------------------------------------------------*/
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void){
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void){
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data){
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError){
+    *PageError = pEraseInit->PageAddress;
+    return HAL_ERROR;
+}
+
+void HAL_Delay(uint32_t Delay){
+    (void)Delay;
+}
@@ -0,0 +1,21 @@
+#ifndef HAL_FAKE_H
+#define HAL_FAKE_H
+
+#include "main.h"
+#include "WS2812B_Timing.h"
+
+// DMA channels behind hspi1 and htim3 channel 1, Running while the driver streams through them
+extern DMA_HandleTypeDef Fake_SPI_DMA;
+extern DMA_HandleTypeDef Fake_TIM_DMA;
+// Data items of the last circular transfer started on each
+extern uint16_t Fake_SPI_Items;
+extern uint16_t Fake_TIM_Items;
+
+// DMA channels behind the USART1 transmitter and the USART2 receiver
+extern DMA_HandleTypeDef Fake_UART1_TxDMA;
+extern DMA_HandleTypeDef Fake_UART2_RxDMA;
+
+void Fake_UART_Receive(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size);
+uint16_t Fake_UART_Send(UART_HandleTypeDef *huart, uint8_t *out);
+
+#endif /* HAL_FAKE_H */
@@ -0,0 +1,124 @@
+#ifndef __MAIN_H
+#define __MAIN_H
+
+/* Host stand-in for Core/Inc/main.h: just enough HAL types for the App sources the tests build.
+ * Peripherals are faked in HAL_Fake.c, the tests drive their interrupts by hand. */
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum {
+    HAL_OK = 0,
+    HAL_ERROR,
+    HAL_BUSY,
+    HAL_TIMEOUT
+} HAL_StatusTypeDef;
+
+typedef struct {
+    uint8_t Running;  // a circular transfer was started and not stopped
+    uint16_t Counter; // NDTR, items left before a circular transfer wraps
+} DMA_HandleTypeDef;
+
+#define __HAL_DMA_GET_COUNTER(h) ((h)->Counter)
+
+typedef struct {
+    DMA_HandleTypeDef *hdmatx;
+} SPI_HandleTypeDef;
+
+typedef enum {
+    HAL_TIM_ACTIVE_CHANNEL_1 = 0x01,
+    HAL_TIM_ACTIVE_CHANNEL_2 = 0x02,
+    HAL_TIM_ACTIVE_CHANNEL_3 = 0x04,
+    HAL_TIM_ACTIVE_CHANNEL_4 = 0x08,
+    HAL_TIM_ACTIVE_CHANNEL_CLEARED = 0x00
+} HAL_TIM_ActiveChannel;
+
+// Registers the driver touches through the __HAL_TIM macros
+typedef struct {
+    uint32_t CR1;
+    uint32_t DIER;
+    uint32_t CCER;
+    uint32_t CNT;
+    uint32_t ARR;
+    uint32_t CCR[4];
+    uint32_t SR;
+} TIM_TypeDef;
+
+typedef struct {
+    TIM_TypeDef *Instance;
+    HAL_TIM_ActiveChannel Channel;
+    DMA_HandleTypeDef *hdma[7];
+} TIM_HandleTypeDef;
+
+#define TIM_CHANNEL_1  0x00000000U
+#define TIM_CHANNEL_2  0x00000004U
+#define TIM_CHANNEL_3  0x00000008U
+#define TIM_CHANNEL_4  0x0000000CU
+#define TIM_DMA_ID_CC1 ((uint16_t)0x0001)
+#define TIM_FLAG_CC1   (1U << 1)
+#define TIM_IT_CC1     (1U << 1)
+#define TIM_CR1_CEN    (1U << 0)
+#define TIM_CCER_CC1E  (1U << 0)
+
+#define __HAL_TIM_GET_AUTORELOAD(h)       ((h)->Instance->ARR)
+#define __HAL_TIM_GET_COUNTER(h)          ((h)->Instance->CNT)
+#define __HAL_TIM_SET_COMPARE(h, ch, val) ((h)->Instance->CCR[(ch) >> 2] = (val))
+#define __HAL_TIM_CLEAR_FLAG(h, flag)     ((h)->Instance->SR &= ~(flag))
+#define __HAL_TIM_ENABLE_IT(h, it)        ((h)->Instance->DIER |= (it))
+#define __HAL_TIM_DISABLE_IT(h, it)       ((h)->Instance->DIER &= ~(it))
+
+typedef enum {
+    HAL_UART_STATE_READY = 0x20,
+    HAL_UART_STATE_BUSY_TX = 0x21,
+    HAL_UART_STATE_BUSY_RX = 0x22
+} HAL_UART_StateTypeDef;
+
+// The transfer fields the chain ports read, filled by the HAL_Fake.c transfers
+typedef struct {
+    DMA_HandleTypeDef *hdmatx;
+    DMA_HandleTypeDef *hdmarx;
+    volatile HAL_UART_StateTypeDef gState;
+    volatile HAL_UART_StateTypeDef RxState;
+    const uint8_t *pTxBuffPtr;
+    uint16_t TxXferSize;
+    uint8_t *pRxBuffPtr;
+    uint16_t RxXferSize;
+    volatile uint16_t RxXferCount;
+} UART_HandleTypeDef;
+
+// No flash behind LED_FLASH_BASE on the host, erasing and programming fail
+#define FLASH_PAGE_SIZE            0x400U
+#define FLASH_TYPEERASE_PAGES      0x00U
+#define FLASH_TYPEPROGRAM_HALFWORD 0x01U
+
+typedef struct {
+    uint32_t TypeErase;
+    uint32_t PageAddress;
+    uint32_t NbPages;
+} FLASH_EraseInitTypeDef;
+
+// Single threaded host, interrupts are whatever the test calls
+static inline uint32_t __get_PRIMASK(void){ return 0; }
+static inline void __set_PRIMASK(uint32_t primask){ (void)primask; }
+static inline void __disable_irq(void){}
+static inline void __enable_irq(void){}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_DMAStop(SPI_HandleTypeDef *hspi);
+HAL_StatusTypeDef HAL_TIM_PWM_Start_DMA(TIM_HandleTypeDef *htim, uint32_t Channel, const uint32_t *pData, uint16_t Length);
+HAL_StatusTypeDef HAL_TIM_PWM_Stop_DMA(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_OC_Start_IT(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_OC_Stop_IT(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size);
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size);
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError);
+void HAL_Delay(uint32_t Delay);
+
+#endif /* __MAIN_H */
@@ -0,0 +1,9 @@
+#ifndef __SPI_H__
+#define __SPI_H__
+
+#include "main.h"
+#include "WS2812B_Timing.h"
+
+extern SPI_HandleTypeDef hspi1;
+
+#endif /* __SPI_H__ */
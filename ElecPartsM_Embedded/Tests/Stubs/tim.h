@@ -0,0 +1,9 @@
+#ifndef __TIM_H__
+#define __TIM_H__
+
+#include "main.h"
+
+extern TIM_HandleTypeDef htim1;
+extern TIM_HandleTypeDef htim3;
+
+#endif /* __TIM_H__ */
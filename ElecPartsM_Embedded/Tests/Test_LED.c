@@ -0,0 +1,287 @@
+#include "LED_Layer.h"
+#include "LED_Highlight.h"
+#include "HAL_Fake.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Host test of the LED modules drawing on a strip: layer compositing checked LED by LED against
+ * a reference blend, and highlight expiries through the timing wheel checked tick by tick.
+ * The strip is single buffered, the composited colors are read straight from its frame. */
+
+static int failures;
+#define CHECK(cond, ...) do{ if(!(cond)){ failures++; printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } }while(0)
+
+#define TEST_LED_NUM 48
+
+static WS2812B_Pixel frame[WS2812B_FRAME_LEN(TEST_LED_NUM)];
+static WS2812B strip = {
+    .LED_Num = TEST_LED_NUM,
+    .Backend = &WS2812B_SPI_Backend,
+    .Handle = &hspi1,
+    .LatchTimer = &htim1,
+    .LatchChannel = TIM_CHANNEL_1,
+    .Brightness = 255,
+    .Frames = {frame, NULL}
+};
+static LED_Color base[TEST_LED_NUM];
+static LED_Layers layers;
+
+// Channels in steps of 36, so additive layers saturate now and then
+static LED_Color RandomColor(void){
+    return (LED_Color){.G = (rand() % 8) * 36, .R = (rand() % 8) * 36, .B = (rand() % 8) * 36};
+}
+
+static void Setup(void){
+    // Nothing drains the faked DMA, every frame after the first coalesces into a pending refresh
+    Fake_SPI_DMA.Running = 0;
+    strip.Status = WS2812B_Idle;
+    memset(frame, 0, sizeof(frame));
+    CHECK(WS2812B_Init(&strip) == WS2812B_OK, "strip init");
+    CHECK(LED_Layer_Init(&layers, &strip, base) == WS2812B_OK, "layer init");
+}
+
+/* Layers ------------------------------------------------------------------*/
+
+// Reference state: the base colors and every layer entry, kept with the semantics of LED_Layer.h
+typedef struct {
+    uint16_t First;
+    uint8_t Count; // 0 when free
+    LED_Color Color;
+} RefEntry;
+
+static LED_Color refBase[TEST_LED_NUM];
+static RefEntry refEntries[LED_LAYER_MAX_NUM][LED_LAYER_MAX_ENTRIES];
+static uint8_t refMode[LED_LAYER_MAX_NUM];
+
+static uint8_t RefOverlaps(const RefEntry *e, uint16_t first, uint16_t count){
+    return e->Count != 0 && e->First < first + count && first < e->First + e->Count;
+}
+
+// Entries replaced or cleared go whole, even when the range only touches them
+static void RefRemove(uint8_t layer, uint16_t first, uint16_t count){
+    for(uint8_t e = 0; e < LED_LAYER_MAX_ENTRIES; e++){
+        if(RefOverlaps(&refEntries[layer][e], first, count)){
+            refEntries[layer][e].Count = 0;
+        }
+    }
+}
+
+static uint8_t RefSet(uint8_t layer, uint16_t first, uint16_t count, LED_Color color){
+    int e = -1;
+    for(uint8_t i = 0; i < LED_LAYER_MAX_ENTRIES && e < 0; i++){
+        if(refEntries[layer][i].Count == 0 || RefOverlaps(&refEntries[layer][i], first, count)){
+            e = i;
+        }
+    }
+    if(e < 0){
+        return 0;
+    }
+    RefRemove(layer, first, count);
+    refEntries[layer][e] = (RefEntry){first, count, color};
+    return 1;
+}
+
+static uint8_t AddChannel(uint8_t a, uint8_t b){
+    return (a + b > 255) ? 255 : a + b;
+}
+
+// Bottom to top: an opaque layer replaces what is below, an additive one adds to it
+static LED_Color RefBlend(uint16_t led){
+    LED_Color color = refBase[led];
+    for(uint8_t layer = 0; layer < LED_LAYER_MAX_NUM; layer++){
+        for(uint8_t e = 0; e < LED_LAYER_MAX_ENTRIES; e++){
+            if(!RefOverlaps(&refEntries[layer][e], led, 1)){
+                continue;
+            }
+            LED_Color c = refEntries[layer][e].Color;
+            if(refMode[layer] == LED_Layer_Opaque){
+                color = c;
+            }else{
+                color.G = AddChannel(color.G, c.G);
+                color.R = AddChannel(color.R, c.R);
+                color.B = AddChannel(color.B, c.B);
+#if WS2812B_RGBW
+                color.W = AddChannel(color.W, c.W);
+#endif
+            }
+        }
+    }
+    return color;
+}
+
+static void CheckStrip(const char *what, int pass){
+    for(uint16_t led = 0; led < TEST_LED_NUM; led++){
+        LED_Color expected = RefBlend(led);
+        if(!WS2812B_SameColor(WS2812B_GetLEDColor(&strip, led), expected)){
+            CHECK(0, "pass %d, %s: LED %u shows another color than the layers make", pass, what, led);
+            return;
+        }
+    }
+}
+
+// Random drawing and layer changes, a few per main loop pass
+static void Test_LayerComposite(void){
+    Setup();
+    memset(refBase, 0, sizeof(refBase));
+    memset(refEntries, 0, sizeof(refEntries));
+    memset(refMode, LED_Layer_Opaque, sizeof(refMode));
+
+    for(int pass = 0; pass < 4000; pass++){
+        for(int op = rand() % 4; op >= 0; op--){
+            uint16_t first = rand() % TEST_LED_NUM;
+            uint16_t count = 1 + rand() % (TEST_LED_NUM - first);
+            uint8_t layer = rand() % LED_LAYER_MAX_NUM;
+            LED_Color color = RandomColor();
+            switch(rand() % 8){
+            case 0: case 1: case 2:
+                CHECK(LED_Layer_Draw(&layers, first, count, color) == WS2812B_OK, "draw refused");
+                for(uint16_t led = first; led < first + count; led++){
+                    refBase[led] = color;
+                }
+                break;
+            case 3: case 4: {
+                // Short ranges, so several entries share a layer
+                count = 1 + count % 6;
+                if(first + count > TEST_LED_NUM){
+                    count = TEST_LED_NUM - first;
+                }
+                uint8_t accepted = (LED_Layer_Set(&layers, layer, first, count, color) == WS2812B_OK);
+                CHECK(accepted == RefSet(layer, first, count, color), "layer %u set %s", layer,
+                      accepted ? "accepted with every entry taken" : "refused with an entry free");
+                break;
+            }
+            case 5:
+                LED_Layer_Clear(&layers, layer, first, count);
+                RefRemove(layer, first, count);
+                break;
+            case 6:
+                LED_Layer_SetMode(&layers, layer, (LED_LayerMode)(rand() % 2));
+                refMode[layer] = layers.Mode[layer];
+                break;
+            default:
+                if(rand() % 8 == 0){
+                    LED_Layer_ClearAll(&layers, layer);
+                    RefRemove(layer, 0, TEST_LED_NUM);
+                }
+                break;
+            }
+        }
+        uint32_t requested = strip.RequestedFrames;
+        uint8_t dirty = (layers.DirtyFirst < layers.DirtyEnd);
+        LED_Layer_Process(&layers);
+        CHECK(strip.RequestedFrames <= requested + 1, "pass %d committed %u times", pass, strip.RequestedFrames - requested);
+        CHECK(dirty || strip.RequestedFrames == requested, "pass %d committed without anything dirty", pass);
+        CHECK(layers.DirtyFirst >= layers.DirtyEnd, "pass %d left a dirty range", pass);
+        CheckStrip("random", pass);
+    }
+}
+
+// Only the LEDs drawn differently become dirty, and a covered LED keeps its new base for later
+static void Test_LayerDirty(void){
+    Setup();
+    LED_Color red = {.R = 255}, blue = {.B = 255}, green = {.G = 255};
+    LED_Layer_Draw(&layers, 0, TEST_LED_NUM, red);
+    LED_Layer_Process(&layers);
+
+    LED_Layer_Draw(&layers, 10, 20, red);
+    CHECK(layers.DirtyFirst >= layers.DirtyEnd, "redrawing the same color made [%u, %u) dirty",
+          layers.DirtyFirst, layers.DirtyEnd);
+    LED_Layer_Draw(&layers, 10, 20, red);
+    LED_Layer_Draw(&layers, 12, 3, blue);
+    CHECK(layers.DirtyFirst == 12 && layers.DirtyEnd == 15, "dirty range [%u, %u) for LEDs [12, 15)",
+          layers.DirtyFirst, layers.DirtyEnd);
+    uint32_t requested = strip.RequestedFrames;
+    LED_Layer_Process(&layers);
+    CHECK(strip.RequestedFrames == requested + 1, "one draw, %u commits", strip.RequestedFrames - requested);
+    requested = strip.RequestedFrames;
+    LED_Layer_Process(&layers);
+    CHECK(strip.RequestedFrames == requested, "idle pass committed");
+
+    // Drawn under an opaque layer: hidden while covered, shown once the layer goes
+    LED_Layer_Set(&layers, 1, 20, 4, green);
+    LED_Layer_Process(&layers);
+    LED_Layer_Draw(&layers, 20, 4, blue);
+    requested = strip.RequestedFrames;
+    LED_Layer_Process(&layers);
+    CHECK(strip.RequestedFrames == requested, "hidden base change committed");
+    CHECK(WS2812B_SameColor(WS2812B_GetLEDColor(&strip, 21), green), "covered LED not showing the layer");
+    LED_Layer_Clear(&layers, 1, 21, 1);
+    LED_Layer_Process(&layers);
+    CHECK(WS2812B_SameColor(WS2812B_GetLEDColor(&strip, 21), blue), "base drawn while covered lost");
+}
+
+/* Highlights --------------------------------------------------------------*/
+
+static LED_Highlights highlights;
+static uint32_t offTick[TEST_LED_NUM]; // tick the LED's highlight goes off in, UINT32_MAX when untimed
+static uint8_t lit[TEST_LED_NUM];
+
+static void RunTicks(uint16_t ticks){
+    for(uint16_t i = 0; i < ticks; i++){
+        LED_Highlight_TickIT(&highlights);
+    }
+    LED_Highlight_Process(&highlights);
+    LED_Layer_Process(&layers);
+}
+
+// One LED per highlight and entry, timeouts spread over every wheel level, ticks processed in batches
+static void Test_HighlightWheel(void){
+    Setup();
+    CHECK(LED_Highlight_Init(&highlights, &layers) == WS2812B_OK, "highlight init");
+    memset(lit, 0, sizeof(lit));
+    LED_Color on = {.G = 255, .R = 36};
+    uint32_t now = 0;
+    uint32_t end = 3 * (1UL << (3 * LED_HIGHLIGHT_WHEEL_BITS));
+
+    while(now < end){
+        // Light a few of the LEDs off now, some of them again while still lit
+        for(int n = rand() % 3; n > 0; n--){
+            uint16_t led = rand() % LED_HIGHLIGHT_MAX_NUM;
+            uint32_t timeout_ms;
+            switch(rand() % 5){
+            case 0: timeout_ms = 0; break;
+            case 1: timeout_ms = 1 + rand() % (LED_HIGHLIGHT_WHEEL_SLOTS * LED_HIGHLIGHT_TICK_MS); break;
+            case 2: timeout_ms = 1 + rand() % (LED_HIGHLIGHT_WHEEL_SLOTS * LED_HIGHLIGHT_WHEEL_SLOTS * LED_HIGHLIGHT_TICK_MS); break;
+            default: timeout_ms = 1 + (uint32_t)rand() % (2 * (1UL << (3 * LED_HIGHLIGHT_WHEEL_BITS)) * LED_HIGHLIGHT_TICK_MS); break;
+            }
+            CHECK(LED_Highlight_Set(&highlights, led, 1, on, timeout_ms) == WS2812B_OK, "highlight refused");
+            lit[led] = 1;
+            offTick[led] = timeout_ms ? now + (timeout_ms + LED_HIGHLIGHT_TICK_MS - 1) / LED_HIGHLIGHT_TICK_MS : UINT32_MAX;
+        }
+        // Batches, as when the main loop was held up
+        uint16_t ticks = (rand() % 4 == 0) ? 1 + rand() % 300 : 1;
+        RunTicks(ticks);
+        now += ticks;
+        for(uint16_t led = 0; led < TEST_LED_NUM; led++){
+            if(lit[led] && now >= offTick[led]){
+                lit[led] = 0;
+            }
+            LED_Color expected = lit[led] ? on : (LED_Color){0};
+            if(!WS2812B_SameColor(WS2812B_GetLEDColor(&strip, led), expected)){
+                CHECK(0, "tick %u: LED %u %s, due off at %u", now, led, lit[led] ? "off early" : "still lit", offTick[led]);
+                lit[led] = !lit[led];
+            }
+        }
+    }
+}
+
+// The longest timeout is capped to what the wheel reaches, not wrapped to a short one
+static void Test_HighlightMaxTimeout(void){
+    Setup();
+    LED_Highlight_Init(&highlights, &layers);
+    LED_Color on = {.B = 255};
+    LED_Highlight_Set(&highlights, 0, 1, on, UINT32_MAX);
+    RunTicks(UINT16_MAX);
+    CHECK(WS2812B_SameColor(WS2812B_GetLEDColor(&strip, 0), on), "capped timeout expired early");
+}
+
+int main(void){
+    srand(1802);
+    Test_LayerDirty();
+    Test_LayerComposite();
+    Test_HighlightWheel();
+    Test_HighlightMaxTimeout();
+    printf("%s: %d failure(s)\n", failures ? "FAILED" : "passed", failures);
+    return failures != 0;
+}
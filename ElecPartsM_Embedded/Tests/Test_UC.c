@@ -0,0 +1,288 @@
+#include "UnitCommute.h"
+#include "UC_Port.h"
+#include "LED_Effect.h"
+#include "LED_Animation.h"
+#include "LED_Highlight.h"
+#include "LED_Layer.h"
+#include "HAL_Fake.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Host test of the chain ports and UnitCommute routing: the UARTs are faked down to their
+ * reception events and transfer completions, IT_Callbacks.c routes those to the ports like on
+ * the unit, and each Pump() is one pass of the main loop over the ports. */
+
+static int failures;
+#define CHECK(cond, ...) do{ if(!(cond)){ failures++; printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } }while(0)
+
+// What main provides to UnitCommute and IT_Callbacks. The LED modules stay uninitialised,
+// the frames sent here never reach them.
+LED_Effects ledEffects[WS2812B_MAX_STRIP_NUM];
+LED_Animation ledAnimation[WS2812B_MAX_STRIP_NUM];
+LED_Highlights ledHighlights[WS2812B_MAX_STRIP_NUM];
+LED_Layers ledLayers[WS2812B_MAX_STRIP_NUM];
+UC_Port ucPorts[UC_PORT_NUM] = {
+    {.Handle = &huart1},
+    {.Handle = &huart2}
+};
+
+#define TEST_UNIT_ID 5
+#define OUT_SIZE 40000
+
+// Bytes each port put on the wire
+static uint8_t out[UC_PORT_NUM][OUT_SIZE];
+static uint32_t outLength[UC_PORT_NUM];
+
+static void Reset(void){
+    for(uint8_t i = 0; i < UC_PORT_NUM; i++){
+        UART_HandleTypeDef *huart = ucPorts[i].Handle;
+        huart->gState = HAL_UART_STATE_READY;
+        huart->RxState = HAL_UART_STATE_READY;
+        CHECK(UC_Port_Init(&ucPorts[i]) == HAL_OK, "port %u init", i);
+        outLength[i] = 0;
+    }
+    unitData.id = TEST_UNIT_ID;
+}
+
+// Let the UART finish what the port queued, transfer after transfer, until the queue is empty
+static void Drain(uint8_t port){
+    UC_Port *p = &ucPorts[port];
+    while(p->Handle->gState == HAL_UART_STATE_BUSY_TX){
+        const uint8_t *start = p->Handle->pTxBuffPtr;
+        CHECK(start >= p->TxRing && start + p->Handle->TxXferSize <= p->TxRing + UC_PORT_TX_SIZE,
+              "transfer runs past the end of the queue");
+        CHECK(outLength[port] + p->Handle->TxXferSize <= OUT_SIZE, "test output buffer full");
+        if(outLength[port] + p->Handle->TxXferSize > OUT_SIZE){
+            return;
+        }
+        outLength[port] += Fake_UART_Send(p->Handle, &out[port][outLength[port]]);
+    }
+}
+
+// One main loop pass over the ports, then the UARTs send everything queued
+static void Pump(void){
+    for(uint8_t port = 0; port < UC_PORT_NUM; port++){
+        uint8_t rxData[UC_PORT_RX_SIZE];
+        uint8_t rxLost;
+        uint16_t rxLength = UC_Port_Read(&ucPorts[port], rxData, sizeof(rxData), &rxLost);
+        if(rxLost){
+            UC_Resync(port + 1);
+        }
+        UC_Receive(port + 1, rxData, rxLength);
+    }
+    UC_Process();
+    for(uint8_t port = 0; port < UC_PORT_NUM; port++){
+        Drain(port);
+    }
+}
+
+// Encoded frame of id, cmd/msg and n random data bytes, returns its length
+static uint16_t Frame(uint8_t id, uint8_t cmdMsg, uint8_t n, uint8_t *encoded){
+    uint8_t frame[UC_FRAME_MAX_SIZE] = {id, cmdMsg};
+    for(uint8_t i = 0; i < n; i++){
+        frame[2 + i] = (rand() % 4 == 0) ? 0 : rand();
+    }
+    return UC_Framing_Encode(frame, 2 + n, encoded);
+}
+
+/* Ports -------------------------------------------------------------------*/
+
+// A write that does not fit leaves the queue untouched, accepted bytes go out in order
+static void Test_TxQueue(void){
+    Reset();
+    UC_Port *port = &ucPorts[0];
+    static uint8_t expected[OUT_SIZE];
+    uint32_t queued = 0;
+    uint8_t next = 0;
+    for(int round = 0; round < 1000; round++){
+        uint8_t data[48];
+        uint16_t size = 1 + rand() % sizeof(data);
+        for(uint16_t i = 0; i < size; i++){
+            data[i] = next + i;
+        }
+        uint16_t head = port->TxHead;
+        uint16_t space = (port->TxTail + UC_PORT_TX_SIZE - head - 1) % UC_PORT_TX_SIZE;
+        HAL_StatusTypeDef status = UC_Port_Write(port, data, size);
+        if(size <= space){
+            CHECK(status == HAL_OK, "%u bytes refused with %u free", size, space);
+            memcpy(&expected[queued], data, size);
+            queued += size;
+            next += size;
+        }else{
+            CHECK(status == HAL_BUSY, "%u bytes accepted with %u free", size, space);
+            CHECK(port->TxHead == head, "refused write moved the queue head");
+        }
+        if(rand() % 3 == 0 && huart1.gState == HAL_UART_STATE_BUSY_TX){
+            outLength[0] += Fake_UART_Send(&huart1, &out[0][outLength[0]]);
+        }
+    }
+    Drain(0);
+    CHECK(outLength[0] == queued && memcmp(out[0], expected, queued) == 0,
+          "%u bytes queued, %u sent or out of order", queued, outLength[0]);
+}
+
+static void Test_RxRing(uint8_t index){
+    Reset();
+    UC_Port *port = &ucPorts[index];
+    UART_HandleTypeDef *huart = port->Handle;
+    uint8_t data[3 * UC_PORT_RX_SIZE], got[UC_PORT_RX_SIZE], lost;
+    uint8_t next = 0;
+
+    // The reader keeps up: up to a full ring between reads, in one to three bursts
+    for(int round = 0; round < 2000; round++){
+        uint16_t n = 1 + rand() % UC_PORT_RX_SIZE;
+        for(uint16_t i = 0; i < n; i++){
+            data[i] = next++;
+        }
+        uint16_t split = rand() % (n + 1);
+        Fake_UART_Receive(huart, data, split);
+        Fake_UART_Receive(huart, &data[split], n - split);
+        uint16_t count = UC_Port_Read(port, got, sizeof(got), &lost);
+        CHECK(!lost && count == n && memcmp(got, data, n) == 0, "port %u round %d: %u of %u bytes read%s",
+              index, round, count, n, lost ? ", reported lost" : "");
+    }
+    CHECK(port->RxOverruns == 0, "port %u: overruns without one", index);
+
+    // More than the ring holds before the next read
+    for(int round = 0; round < 200; round++){
+        uint16_t n = UC_PORT_RX_SIZE + 1 + rand() % (2 * UC_PORT_RX_SIZE);
+        memset(data, 0x55, n);
+        Fake_UART_Receive(huart, data, n);
+        uint32_t overruns = port->RxOverruns;
+        uint16_t count = UC_Port_Read(port, got, sizeof(got), &lost);
+        CHECK(lost && count == 0 && port->RxOverruns == overruns + 1, "port %u: overrun of %u bytes not reported",
+              index, n);
+        // Reading picks up with what arrives next
+        for(uint16_t i = 0; i < 10; i++){
+            data[i] = next++;
+        }
+        Fake_UART_Receive(huart, data, 10);
+        count = UC_Port_Read(port, got, sizeof(got), &lost);
+        CHECK(!lost && count == 10 && memcmp(got, data, 10) == 0, "port %u: %u bytes read after an overrun", index, count);
+    }
+}
+
+// DMA reception restarts at the ring start after a UART error, the reader is told bytes went missing
+static void Test_RxError(void){
+    Reset();
+    UC_Port *port = &ucPorts[1];
+    uint8_t data[8] = {1, 2, 3, 4, 5, 6, 7, 8}, got[UC_PORT_RX_SIZE], lost;
+    Fake_UART_Receive(&huart2, data, 8);
+    UC_Port_Read(port, got, sizeof(got), &lost);
+    Fake_UART_Receive(&huart2, data, 7);
+    huart2.RxState = HAL_UART_STATE_READY;
+    UC_Port_ErrorIT(port);
+    Fake_UART_Receive(&huart2, &data[3], 5);
+    uint16_t count = UC_Port_Read(port, got, sizeof(got), &lost);
+    CHECK(lost && count == 5 && memcmp(got, &data[3], 5) == 0, "%u bytes read after the restart%s", count,
+          lost ? "" : ", loss not reported");
+}
+
+/* Routing -----------------------------------------------------------------*/
+
+// Frames for other units leave the opposite port byte for byte, however they arrive
+static void Test_CutThrough(void){
+    Reset();
+    static uint8_t upstream[OUT_SIZE], downstream[OUT_SIZE];
+    uint32_t upLength = 0, downLength = 0;
+    for(int n = 0; n < 1000; n++){
+        uint8_t encoded[UC_FRAMING_MAX_ENCODED(UC_FRAME_MAX_SIZE)];
+        uint8_t id;
+        switch(rand() % 4){
+        case 0: id = 0; break;            // broadcast, answered upstream
+        case 1: id = TEST_UNIT_ID; break; // ours, no answer for these commands
+        default: id = 1 + rand() % 20; id += (id == TEST_UNIT_ID); break;
+        }
+        // Done and error have no handler on the unit
+        uint8_t cmdMsg = ((rand() % 2) ? UC_CommandDone : UC_Error) << 4;
+        uint16_t length = Frame(id, cmdMsg, rand() % (UC_FRAME_MAX_SIZE - 1), encoded);
+        for(uint16_t i = 0; i < length;){
+            uint16_t chunk = 1 + rand() % (length - i);
+            Fake_UART_Receive(&huart1, &encoded[i], chunk);
+            Pump();
+            i += chunk;
+        }
+        if(id == 0){
+            memcpy(&upstream[upLength], encoded, length);
+            upLength += length;
+        }else if(id != TEST_UNIT_ID){
+            memcpy(&downstream[downLength], encoded, length);
+            downLength += length;
+        }
+    }
+    CHECK(outLength[1] == downLength && memcmp(out[1], downstream, downLength) == 0,
+          "forwarded %u bytes for %u expected, or changed them", outLength[1], downLength);
+    CHECK(outLength[0] == upLength && memcmp(out[0], upstream, upLength) == 0,
+          "answered %u bytes for %u expected, or changed them", outLength[0], upLength);
+}
+
+// An answer due on a port while a forward is mid-frame there goes out after the forward's delimiter
+static void Test_HeldAnswer(void){
+    Reset();
+    uint8_t forward[UC_FRAMING_MAX_ENCODED(UC_FRAME_MAX_SIZE)], broadcast[UC_FRAMING_MAX_ENCODED(UC_FRAME_MAX_SIZE)];
+    uint16_t forwardLength = Frame(3, UC_CommandDone << 4, 6, forward);
+    uint16_t broadcastLength = Frame(0, UC_CommandDone << 4, 2, broadcast);
+    // From the next unit (USART2) towards the host (USART1), half of it
+    Fake_UART_Receive(&huart2, forward, forwardLength / 2);
+    Pump();
+    Fake_UART_Receive(&huart1, broadcast, broadcastLength);
+    Pump();
+    CHECK(outLength[0] == forwardLength / 2, "answer put inside the forwarded frame");
+    Fake_UART_Receive(&huart2, &forward[forwardLength / 2], forwardLength - forwardLength / 2);
+    Pump();
+    CHECK(outLength[0] == forwardLength + broadcastLength && memcmp(out[0], forward, forwardLength) == 0 &&
+          memcmp(&out[0][forwardLength], broadcast, broadcastLength) == 0, "forward and held answer sent as %u bytes",
+          outLength[0]);
+}
+
+/* A forward the opposite port has no room for is cut short and ended with a delimiter, so is one
+ * whose bytes were lost on the way in. The next frame goes through whole. */
+static void Test_CutShort(void){
+    uint8_t a[UC_FRAMING_MAX_ENCODED(UC_FRAME_MAX_SIZE)], b[UC_FRAMING_MAX_ENCODED(UC_FRAME_MAX_SIZE)];
+    uint16_t aLength = Frame(7, UC_CommandDone << 4, UC_FRAME_MAX_SIZE - 2, a);
+    uint16_t bLength = Frame(7, UC_CommandDone << 4, 3, b);
+
+    // USART2 busy with a long transfer, fewer bytes free than the frame needs
+    Reset();
+    uint8_t filler[UC_PORT_TX_SIZE - 8];
+    memset(filler, 0x55, sizeof(filler));
+    UC_Port_Write(&ucPorts[1], filler, sizeof(filler));
+    Fake_UART_Receive(&huart1, a, aLength);
+    Pump();
+    Fake_UART_Receive(&huart1, b, bLength);
+    Pump();
+    uint32_t at = sizeof(filler);
+    CHECK(outLength[1] == at + 2 + bLength && out[1][at] == a[0] && out[1][at + 1] == UC_FRAME_DELIMITER &&
+          memcmp(&out[1][at + 2], b, bLength) == 0, "full port: %u bytes forwarded", outLength[1] - at);
+
+    // Overrun of the receive ring in the middle of a forward
+    Reset();
+    Fake_UART_Receive(&huart1, a, 4);
+    Pump();
+    uint8_t noise[UC_PORT_RX_SIZE + 10];
+    memset(noise, 0x55, sizeof(noise));
+    Fake_UART_Receive(&huart1, noise, sizeof(noise));
+    Pump();
+    CHECK(ucPorts[0].RxOverruns == 1, "overrun not counted");
+    // The rest of the broken frame, then a whole one
+    uint8_t rest[3] = {0x55, 0x55, UC_FRAME_DELIMITER};
+    Fake_UART_Receive(&huart1, rest, sizeof(rest));
+    Fake_UART_Receive(&huart1, b, bLength);
+    Pump();
+    CHECK(outLength[1] == 4u + 1 + bLength && memcmp(out[1], a, 4) == 0 && out[1][4] == UC_FRAME_DELIMITER &&
+          memcmp(&out[1][5], b, bLength) == 0, "overrun: %u bytes forwarded", outLength[1]);
+}
+
+int main(void){
+    srand(485);
+    Test_TxQueue();
+    Test_RxRing(0);
+    Test_RxRing(1);
+    Test_RxError();
+    Test_CutThrough();
+    Test_HeldAnswer();
+    Test_CutShort();
+    printf("%s: %d failure(s)\n", failures ? "FAILED" : "passed", failures);
+    return failures != 0;
+}
@@ -0,0 +1,84 @@
+#include "UC_Framing.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Host test of the UnitCommute wire framing, the same file a host side encoder links
+
+static int failures;
+#define CHECK(cond, ...) do{ if(!(cond)){ failures++; printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } }while(0)
+
+#define MAX_FRAME 600
+
+// Known frame: id 10 (the old '\n'), a zero and a 0x0A data byte
+static void Test_Vector(void){
+    const uint8_t frame[] = {0x0A, 0x41, 0x00, 0x0A};
+    uint8_t out[UC_FRAMING_MAX_ENCODED(sizeof(frame))];
+    uint16_t length = UC_Framing_Encode(frame, sizeof(frame), out);
+    uint8_t crc = UC_Framing_CRC8(frame, sizeof(frame));
+    const uint8_t expected[] = {0x03, 0x0A, 0x41, 0x03, 0x0A, crc, UC_FRAME_DELIMITER};
+    CHECK(crc != 0, "vector CRC happens to be 0, pick another vector");
+    CHECK(length == sizeof(expected) && memcmp(out, expected, sizeof(expected)) == 0, "vector encodes differently");
+    CHECK(UC_Framing_Decode(out, length - 1) == sizeof(frame) && memcmp(out, frame, sizeof(frame)) == 0,
+          "vector does not decode back");
+}
+
+// CRC-8/SMBUS check value
+static void Test_CRC(void){
+    const uint8_t check[] = "123456789";
+    CHECK(UC_Framing_CRC8(check, 9) == 0xF4, "CRC of \"123456789\" is 0x%02X", UC_Framing_CRC8(check, 9));
+}
+
+static void Test_RoundTrip(void){
+    static uint8_t frame[MAX_FRAME], encoded[UC_FRAMING_MAX_ENCODED(MAX_FRAME)];
+    int accepted = 0;
+    for(int t = 0; t < 20000; t++){
+        uint16_t n = 1 + rand() % ((t < 1000) ? MAX_FRAME : 12);
+        for(uint16_t i = 0; i < n; i++){
+            frame[i] = (rand() % 3 == 0) ? 0 : rand();
+        }
+        if(t % 7 == 0){
+            // Long runs without a zero need the 254 byte block split
+            memset(frame, 0xFF, n);
+        }
+        uint16_t length = UC_Framing_Encode(frame, n, encoded);
+        CHECK(length <= UC_FRAMING_MAX_ENCODED(n), "%u byte frame encoded to %u bytes", n, length);
+        CHECK(memchr(encoded, UC_FRAME_DELIMITER, length - 1) == NULL, "delimiter inside an encoded frame");
+        CHECK(encoded[length - 1] == UC_FRAME_DELIMITER, "encoded frame not terminated");
+
+        static uint8_t work[UC_FRAMING_MAX_ENCODED(MAX_FRAME)];
+        memcpy(work, encoded, length - 1);
+        CHECK(UC_Framing_Decode(work, length - 1) == n && memcmp(work, frame, n) == 0, "%u byte frame does not round trip", n);
+
+        // One flipped bit, never turning a byte into the delimiter the receiver would split on
+        memcpy(work, encoded, length - 1);
+        uint16_t k = rand() % (length - 1);
+        work[k] ^= 1 << (rand() % 8);
+        if(work[k] == UC_FRAME_DELIMITER){
+            work[k] = encoded[k] ^ 0x80;
+        }
+        accepted += (UC_Framing_Decode(work, length - 1) != 0);
+    }
+    // Layout changes from a corrupted code byte slip through CRC-8 about once in 256
+    CHECK(accepted < 20000 / 256 + 20, "%d of 20000 corrupted frames accepted", accepted);
+    printf("corrupted frames accepted: %d of 20000\n", accepted);
+}
+
+static void Test_Malformed(void){
+    uint8_t empty[1] = {0};
+    CHECK(UC_Framing_Decode(empty, 0) == 0, "empty frame accepted");
+    uint8_t overrun[] = {0x05, 0x11, 0x22};
+    CHECK(UC_Framing_Decode(overrun, sizeof(overrun)) == 0, "code byte past the end accepted");
+    uint8_t crcOnly[] = {0x01};
+    CHECK(UC_Framing_Decode(crcOnly, sizeof(crcOnly)) == 0, "frame without data accepted");
+}
+
+int main(void){
+    srand(1);
+    Test_CRC();
+    Test_Vector();
+    Test_RoundTrip();
+    Test_Malformed();
+    printf("%s: %d failure(s)\n", failures ? "FAILED" : "passed", failures);
+    return failures != 0;
+}
@@ -0,0 +1,460 @@
+#define _POSIX_C_SOURCE 199309L
+#include "WS2812B_Driver.h"
+#include "HAL_Fake.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Host test of the WS2812B driver for the line configuration it is built with (see Makefile):
+ * frames are streamed through the faked DMA, the captured SPI / PWM data is turned back into a
+ * waveform, decoded into colors and every high and low time checked against the datasheet window.
+ * The nibble table encoders are compared bit for bit with per-bit reference encoders. */
+
+static int failures;
+#define CHECK(cond, ...) do{ if(!(cond)){ failures++; printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } }while(0)
+
+#define TEST_LED_NUM WS2812B_MAX_LED_NUM
+#define COLOR_BYTES (WS2812B_BITS_PER_LED / 8)
+
+/* Waveform ----------------------------------------------------------------*/
+
+typedef struct {
+    uint8_t Level;
+    uint64_t Length_ps;
+} Run;
+
+// Two runs per LED bit, plus the zero slots behind the data
+static Run runs[2 * WS2812B_BITS_PER_LED * (TEST_LED_NUM + 4)];
+static int runNum;
+
+static void Line_Reset(void){
+    runNum = 0;
+}
+
+static void Line_Append(uint8_t level, uint64_t length_ps){
+    if(length_ps == 0){
+        return;
+    }
+    if(runNum > 0 && runs[runNum - 1].Level == level){
+        runs[runNum - 1].Length_ps += length_ps;
+        return;
+    }
+    runs[runNum].Level = level;
+    runs[runNum].Length_ps = length_ps;
+    runNum++;
+}
+
+// SPI sends each frame MSB first, idle low between nothing: frames follow back to back
+static void Capture_SPI(const uint8_t *slot){
+    const WS2812B_SPI_Word *words = (const WS2812B_SPI_Word *)slot;
+    for(int w = 0; w < WS2812B_SPI_SLOT_LEN; w++){
+        for(int bit = WS2812B_SPI_FRAME_BITS - 1; bit >= 0; bit--){
+            Line_Append((words[w] >> bit) & 1, WS2812B_SPI_CLK_PS);
+        }
+    }
+}
+
+// Each compare byte is one PWM period, high for the compare value
+static void Capture_TIM(const uint8_t *slot){
+    for(int i = 0; i < WS2812B_TIM_SLOT_LEN; i++){
+        Line_Append(1, slot[i] * WS2812B_TIM_TICK_PS);
+        Line_Append(0, (WS2812B_TIM_PERIOD - slot[i]) * WS2812B_TIM_TICK_PS);
+    }
+}
+
+/* Turn the waveform back into color bytes. Every high and low time must sit in its datasheet
+ * window, the low of the last bit runs into the reset and only has to be long enough.
+ * Returns the bits decoded, -1 on a timing violation. */
+static int Line_Decode(uint8_t *bytes, int maxBytes, uint64_t *symbol_ps){
+    int bits = 0;
+    int i = 0;
+    *symbol_ps = 0;
+    CHECK(runNum > 0 && runs[0].Level == 1, "line does not start with a high");
+    while(i < runNum && runs[i].Level == 1){
+        uint64_t high = runs[i].Length_ps;
+        uint64_t low = (i + 1 < runNum) ? runs[i + 1].Length_ps : 0;
+        uint8_t last = (i + 2 >= runNum);
+        int value;
+        if(WS2812B_IN_TOL(high, WS2812B_T1H_NS)){
+            value = 1;
+        }else if(WS2812B_IN_TOL(high, WS2812B_T0H_NS)){
+            value = 0;
+        }else{
+            CHECK(0, "bit %d: high of %llu ps fits neither T0H nor T1H", bits, (unsigned long long)high);
+            return -1;
+        }
+        uint64_t nominalLow = value ? WS2812B_T1L_NS : WS2812B_T0L_NS;
+        if(last){
+            CHECK(low + WS2812B_TOL_NS * 1000ULL >= nominalLow * 1000ULL, "last bit: low of %llu ps too short", (unsigned long long)low);
+        }else if(!WS2812B_IN_TOL(low, nominalLow)){
+            CHECK(0, "bit %d: low of %llu ps outside %llu +- %d ns", bits, (unsigned long long)low,
+                  (unsigned long long)nominalLow, WS2812B_TOL_NS);
+            return -1;
+        }else if(*symbol_ps == 0){
+            *symbol_ps = high + low;
+        }else if(*symbol_ps != high + low){
+            CHECK(0, "bit %d: symbol of %llu ps, earlier ones %llu ps", bits, (unsigned long long)(high + low),
+                  (unsigned long long)*symbol_ps);
+            return -1;
+        }
+        if(bits / 8 >= maxBytes){
+            CHECK(0, "more bits on the line than LEDs sent");
+            return -1;
+        }
+        if(bits % 8 == 0){
+            bytes[bits / 8] = 0;
+        }
+        bytes[bits / 8] |= value << (7 - bits % 8);
+        bits++;
+        i += 2;
+    }
+    return bits;
+}
+
+/* Streaming ---------------------------------------------------------------*/
+
+static WS2812B_Pixel spiFrames[2][WS2812B_FRAME_LEN(TEST_LED_NUM)];
+static WS2812B_Pixel timFrames[2][WS2812B_FRAME_LEN(TEST_LED_NUM)];
+
+static WS2812B spiStrip = {
+    .Backend = &WS2812B_SPI_Backend,
+    .Handle = &hspi1,
+    .LatchTimer = &htim1,
+    .LatchChannel = TIM_CHANNEL_1,
+    .Brightness = 255,
+    .Frames = {spiFrames[0], spiFrames[1]}
+};
+static WS2812B timStrip = {
+    .Backend = &WS2812B_TIM_Backend,
+    .Handle = &htim3,
+    .Channel = TIM_CHANNEL_1,
+    .LatchTimer = &htim1,
+    .LatchChannel = TIM_CHANNEL_2,
+    .Brightness = 255,
+    .Frames = {timFrames[0], timFrames[1]}
+};
+
+// Play the DMA: send a slot, raise its interrupt, until the driver stops the transfer and latches
+static void Stream(WS2812B *strip, DMA_HandleTypeDef *dma, void (*capture)(const uint8_t *slot)){
+    Line_Reset();
+    uint8_t slot = 0;
+    for(int guard = 0; dma->Running && guard < 4 * (TEST_LED_NUM + 4); guard++){
+        capture((const uint8_t *)strip->DMA_Buffer + slot * strip->Backend->SlotBytes);
+        if(slot == 0){
+            WS2812B_DMA_HalfIT(strip);
+        }else{
+            WS2812B_DMA_IT(strip);
+        }
+        slot ^= 1;
+    }
+    CHECK(!dma->Running, "transfer never stopped");
+    CHECK(strip->Status == WS2812B_Latching, "strip not latching after the frame, status %d", strip->Status);
+    uint32_t latchIT = TIM_IT_CC1 << (strip->LatchChannel >> 2);
+    CHECK(strip->LatchTimer->Instance->DIER & latchIT, "latch compare interrupt not armed");
+    WS2812B_LatchIT(strip);
+    CHECK(!(strip->LatchTimer->Instance->DIER & latchIT), "latch compare interrupt still armed");
+    // The latch timer's update is the effect tick, latching must never stop its counter
+    CHECK(strip->LatchTimer->Instance->CR1 & TIM_CR1_CEN, "latch timer stopped after the latch");
+}
+
+static LED_Color RandomColor(void){
+    LED_Color color = {.G = rand(), .R = rand(), .B = rand()};
+#if WS2812B_RGBW
+    color.W = rand();
+#endif
+#if WS2812B_PALETTE_BITS
+    // A frame has to fit the palette, draw from 8 colors
+    uint8_t pick = rand() % 8;
+    color = (LED_Color){.G = pick * 31, .R = 255 - pick * 17, .B = pick * pick};
+#endif
+    return color;
+}
+
+static void ColorBytes(WS2812B *strip, LED_Color color, uint8_t *bytes){
+    bytes[0] = strip->ColorLUT[color.G];
+    bytes[1] = strip->ColorLUT[color.R];
+    bytes[2] = strip->ColorLUT[color.B];
+#if WS2812B_RGBW
+    bytes[3] = strip->ColorLUT[color.W];
+#endif
+}
+
+static uint64_t spiSymbol_ps;
+static uint64_t timSymbol_ps;
+
+// Send one frame of the back buffer and check the line carries sendNum LEDs of it
+static void Check_Frame(WS2812B *strip, DMA_HandleTypeDef *dma, void (*capture)(const uint8_t *), uint16_t sendNum,
+                        uint64_t *symbol_ps){
+    static uint8_t expected[COLOR_BYTES * TEST_LED_NUM];
+    static uint8_t decoded[COLOR_BYTES * TEST_LED_NUM];
+    CHECK(WS2812B_Commit(strip) == WS2812B_OK, "commit refused");
+    Stream(strip, dma, capture);
+    // ColorLUT is rebuilt at the frame start when the current limit lowers the output level
+    for(uint16_t i = 0; i < sendNum; i++){
+        ColorBytes(strip, WS2812B_GetLEDColor(strip, i), &expected[i * COLOR_BYTES]);
+    }
+    int bits = Line_Decode(decoded, sizeof(decoded), symbol_ps);
+    CHECK(bits == sendNum * WS2812B_BITS_PER_LED, "%s: %d bits on the line for %u LEDs",
+          strip->Backend == &WS2812B_SPI_Backend ? "SPI" : "TIM", bits, sendNum);
+    if(bits == sendNum * WS2812B_BITS_PER_LED){
+        for(uint16_t i = 0; i < sendNum; i++){
+            if(memcmp(&expected[i * COLOR_BYTES], &decoded[i * COLOR_BYTES], COLOR_BYTES) != 0){
+                CHECK(0, "LED %u decoded to other colors than set", i);
+                break;
+            }
+        }
+    }
+}
+
+static void Test_Frames(WS2812B *strip, DMA_HandleTypeDef *dma, void (*capture)(const uint8_t *), uint64_t *symbol_ps){
+    static const uint16_t sizes[] = {1, 2, 8, 37, TEST_LED_NUM};
+    for(unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++){
+        strip->LED_Num = sizes[s];
+        CHECK(WS2812B_Init(strip) == WS2812B_OK, "init with %u LEDs", sizes[s]);
+        // Runs of one color and single LEDs, the slot encoder skips re-encoding inside runs
+        LED_Color color = RandomColor();
+        for(uint16_t i = 0; i < strip->LED_Num; i++){
+            if(rand() % 3 == 0){
+                color = RandomColor();
+            }
+            WS2812B_SetLEDColor(strip, i, color);
+        }
+        // First frame after init sends the whole strip
+        Check_Frame(strip, dma, capture, strip->LED_Num, symbol_ps);
+        // Afterwards only the prefix up to the last changed LED
+        uint16_t changed = rand() % strip->LED_Num;
+        LED_Color other;
+        do{
+            other = RandomColor();
+        }while(WS2812B_SameColor(other, WS2812B_GetLEDColor(strip, changed)));
+        WS2812B_SetLEDColor(strip, changed, other);
+        Check_Frame(strip, dma, capture, changed + 1, symbol_ps);
+    }
+    CHECK(Fake_SPI_Items == 2 * WS2812B_SPI_SLOT_LEN || strip->Backend != &WS2812B_SPI_Backend,
+          "SPI transfer of %u items", Fake_SPI_Items);
+    CHECK(Fake_TIM_Items == 2 * WS2812B_TIM_SLOT_LEN || strip->Backend != &WS2812B_TIM_Backend,
+          "TIM transfer of %u items", Fake_TIM_Items);
+}
+
+// The limited output level must match the division it replaces, for any budget and frame intensity
+static void Test_CurrentLimit(void){
+    WS2812B *strip = &spiStrip;
+    strip->LED_Num = TEST_LED_NUM;
+    CHECK(WS2812B_Init(strip) == WS2812B_OK, "init");
+    static const uint16_t limits[] = {0, 1, 50, 500, 1000, 3000, 20000, 65535};
+    for(unsigned l = 0; l < sizeof(limits) / sizeof(limits[0]); l++){
+        WS2812B_SetCurrentLimit(strip, limits[l]);
+        for(int t = 0; t < 20; t++){
+            uint16_t lit = rand() % (TEST_LED_NUM + 1);
+            LED_Color color = RandomColor();
+            WS2812B_FillLEDColor(strip, 0, TEST_LED_NUM, (LED_Color){0});
+            WS2812B_FillLEDColor(strip, 0, lit, color);
+            uint32_t intensity = strip->IntensitySum;
+            uint32_t level = strip->Brightness;
+            if(limits[l] != 0 && intensity != 0){
+                level = (uint32_t)limits[l] * 255 * 255 / (intensity * WS2812B_MA_PER_CHANNEL);
+                level = (level < strip->Brightness) ? level : strip->Brightness;
+            }
+            CHECK(WS2812B_Commit(strip) == WS2812B_OK, "commit refused");
+            Stream(strip, &Fake_SPI_DMA, Capture_SPI);
+            CHECK(strip->OutputLevel == level, "limit %u mA, intensity %u: level %u, division gives %u",
+                  limits[l], (unsigned)intensity, strip->OutputLevel, (unsigned)level);
+        }
+    }
+    WS2812B_SetCurrentLimit(strip, 0);
+}
+
+#if WS2812B_PALETTE_BITS
+static uint16_t PaletteIndexOf(WS2812B *strip, LED_Color color){
+    for(uint16_t i = 0; i < strip->PaletteUsed; i++){
+        if(WS2812B_SameColor(strip->Palette[i], color)){
+            return i;
+        }
+    }
+    return WS2812B_PALETTE_SIZE;
+}
+
+// Use counts must match the LEDs of Back pointing at each entry
+static void CheckPaletteUse(WS2812B *strip){
+    static uint16_t use[WS2812B_PALETTE_SIZE];
+    memset(use, 0, sizeof(use));
+    for(uint16_t i = 0; i < strip->LED_Num; i++){
+#if WS2812B_PALETTE_BITS == 4
+        use[(strip->Back[i >> 1] >> ((i & 1) * 4)) & 0x0F]++;
+#else
+        use[strip->Back[i]]++;
+#endif
+    }
+    CHECK(memcmp(use, strip->PaletteUse, sizeof(use)) == 0, "palette use counts off");
+}
+
+// More distinct colors over time than the palette holds, a few at a time
+static void Test_Palette(void){
+    WS2812B *strip = &spiStrip;
+    strip->LED_Num = 37;
+    strip->PaletteUsed = 0;
+    CHECK(WS2812B_Init(strip) == WS2812B_OK, "init");
+    for(uint16_t n = 0; n < 4 * WS2812B_PALETTE_SIZE; n++){
+        LED_Color color = {.G = n, .R = n >> 8, .B = 0x5A};
+        // Three colors on the strip at a time: black, the last one and the new one
+        CHECK(WS2812B_FillLEDColor(strip, 0, 3, (LED_Color){0}) == WS2812B_OK, "color %u: black", n);
+        CHECK(WS2812B_FillLEDColor(strip, 3, 5, color) == WS2812B_OK, "color %u: palette full", n);
+        CheckPaletteUse(strip);
+        // The first frame after init sends the whole strip, then only the 8 LEDs drawn
+        Check_Frame(strip, &Fake_SPI_DMA, Capture_SPI, (n == 0) ? strip->LED_Num : 8, &spiSymbol_ps);
+    }
+    CHECK(strip->PaletteUsed <= 4, "%u entries for 3 colors at a time", strip->PaletteUsed);
+
+    // An entry Back no longer uses stays put until the commit, Front still shows it
+    LED_Color a = {.G = 1, .R = 2, .B = 3}, b = {.G = 4, .R = 5, .B = 6}, c = {.G = 7, .R = 8, .B = 9};
+    WS2812B_FillLEDColor(strip, 0, strip->LED_Num, a);
+    Check_Frame(strip, &Fake_SPI_DMA, Capture_SPI, strip->LED_Num, &spiSymbol_ps);
+    uint16_t entryA = PaletteIndexOf(strip, a);
+    WS2812B_FillLEDColor(strip, 0, strip->LED_Num, b);
+    WS2812B_SetLEDColor(strip, 0, c);
+    CHECK(entryA < WS2812B_PALETTE_SIZE && WS2812B_SameColor(strip->Palette[entryA], a),
+          "entry still shown by Front was reused before the commit");
+    CheckPaletteUse(strip);
+    Check_Frame(strip, &Fake_SPI_DMA, Capture_SPI, strip->LED_Num, &spiSymbol_ps);
+    // After it, the entry is free for the next new color
+    LED_Color d = {.G = 10, .R = 11, .B = 12};
+    WS2812B_SetLEDColor(strip, 1, d);
+    CHECK(PaletteIndexOf(strip, d) == entryA, "freed entry %u not reused", entryA);
+    CheckPaletteUse(strip);
+}
+#endif
+
+/* Encoders ----------------------------------------------------------------*/
+
+// The per-bit encoders the nibble tables replaced, one test and branch per LED bit
+static void Reference_SPI_EncodeLED(uint8_t *slot, LED_Color color){
+    uint8_t bytes[4] = {color.G, color.R, color.B, 0};
+#if WS2812B_RGBW
+    bytes[3] = color.W;
+#endif
+#if WS2812B_SPI_3BIT_SYMBOLS
+    uint32_t acc = 0;
+    int accBits = 0;
+    for(int b = 0; b < COLOR_BYTES; b++){
+        for(int bit = 7; bit >= 0; bit--){
+            acc = (acc << 3) | ((bytes[b] & (1 << bit)) ? WS2812B_SPI_SYMBOL_1 : WS2812B_SPI_SYMBOL_0);
+            accBits += 3;
+            if(accBits >= 8){
+                *slot++ = (uint8_t)(acc >> (accBits - 8));
+                accBits -= 8;
+            }
+        }
+    }
+#else
+    uint16_t *symbols = (uint16_t *)slot;
+    for(int b = 0; b < COLOR_BYTES; b++){
+        for(int bit = 0; bit < 8; bit++){
+            *symbols++ = (bytes[b] & (1 << (7 - bit))) ? WS2812B_SPI_SYMBOL_1 : WS2812B_SPI_SYMBOL_0;
+        }
+    }
+#endif
+}
+
+static void Reference_TIM_EncodeLED(uint8_t *slot, LED_Color color){
+    uint8_t bytes[4] = {color.G, color.R, color.B, 0};
+#if WS2812B_RGBW
+    bytes[3] = color.W;
+#endif
+    for(int b = 0; b < COLOR_BYTES; b++){
+        for(int bit = 0; bit < 8; bit++){
+            *slot++ = (bytes[b] & (1 << (7 - bit))) ? WS2812B_TIM_T1H : WS2812B_TIM_T0H;
+        }
+    }
+}
+
+// Every byte value in every channel, bit identical to the reference
+static void Test_Encoders(void){
+    uint32_t table[WS2812B_DMA_BUFFER_WORDS], reference[WS2812B_DMA_BUFFER_WORDS];
+    for(int v = 0; v < 256; v++){
+        LED_Color color = {.G = v, .R = v ^ 0xFF, .B = v ^ 0x5A};
+#if WS2812B_RGBW
+        color.W = 255 - v;
+#endif
+        WS2812B_SPI_Backend.EncodeLED((uint8_t *)table, color);
+        Reference_SPI_EncodeLED((uint8_t *)reference, color);
+        CHECK(memcmp(table, reference, WS2812B_SPI_SLOT_BYTES) == 0, "SPI encoding of byte 0x%02X differs", v);
+        WS2812B_TIM_Backend.EncodeLED((uint8_t *)table, color);
+        Reference_TIM_EncodeLED((uint8_t *)reference, color);
+        CHECK(memcmp(table, reference, WS2812B_TIM_SLOT_BYTES) == 0, "TIM encoding of byte 0x%02X differs", v);
+    }
+}
+
+static double Now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Host time per LED, only meaningful compared between encoders of the same build
+static double Bench(void (*encode)(uint8_t *, LED_Color), uint32_t *checksum){
+    enum { LEDS = 2000000 };
+    uint32_t slot[WS2812B_DMA_BUFFER_WORDS];
+    double start = Now_ns();
+    for(uint32_t i = 0; i < LEDS; i++){
+        LED_Color color = {.G = i, .R = i >> 3, .B = i >> 5};
+        encode((uint8_t *)slot, color);
+        *checksum += slot[0] ^ slot[1];
+    }
+    return (Now_ns() - start) / LEDS;
+}
+
+static void Report_Encoders(void){
+    uint32_t checksum = 0;
+    double spiTable = Bench(WS2812B_SPI_Backend.EncodeLED, &checksum);
+    double spiBits = Bench(Reference_SPI_EncodeLED, &checksum);
+    double timTable = Bench(WS2812B_TIM_Backend.EncodeLED, &checksum);
+    double timBits = Bench(Reference_TIM_EncodeLED, &checksum);
+    printf("encode, host ns per LED (color bytes per s):  [checksum %08x]\n", (unsigned)checksum);
+    printf("  SPI nibble table %6.2f (%5.1f M)   per-bit %6.2f (%5.1f M)\n",
+           spiTable, COLOR_BYTES * 1e3 / spiTable, spiBits, COLOR_BYTES * 1e3 / spiBits);
+    printf("  TIM nibble table %6.2f (%5.1f M)   per-bit %6.2f (%5.1f M)\n",
+           timTable, COLOR_BYTES * 1e3 / timTable, timBits, COLOR_BYTES * 1e3 / timBits);
+}
+
+/* Refresh rate ------------------------------------------------------------*/
+
+// The frame time macros must agree with the symbols actually measured on the line
+static void Test_FrameRates(void){
+    static const uint16_t sizes[] = {8, 16, 30, 60, 100, 150, 300, 500, 1000};
+    printf("frame time incl. %dus reset, us (fps):\n", WS2812B_RESET_US);
+    for(unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++){
+        uint32_t n = sizes[s];
+        uint64_t spiUs = WS2812B_SPI_FRAME_US(n);
+        uint64_t timUs = WS2812B_TIM_FRAME_US(n);
+        uint64_t spiLine = n * WS2812B_BITS_PER_LED * spiSymbol_ps / 1000000ULL + WS2812B_RESET_US;
+        uint64_t timLine = n * WS2812B_BITS_PER_LED * timSymbol_ps / 1000000ULL + WS2812B_RESET_US;
+        CHECK(spiUs + 1 >= spiLine && spiUs <= spiLine + 1, "SPI_FRAME_US(%u) = %llu, line says %llu",
+              (unsigned)n, (unsigned long long)spiUs, (unsigned long long)spiLine);
+        CHECK(timUs + 1 >= timLine && timUs <= timLine + 1, "TIM_FRAME_US(%u) = %llu, line says %llu",
+              (unsigned)n, (unsigned long long)timUs, (unsigned long long)timLine);
+        printf("  %4u LEDs  SPI %6llu (%6.1f)  TIM %6llu (%6.1f)\n", (unsigned)n,
+               (unsigned long long)spiUs, 1e6 / spiUs, (unsigned long long)timUs, 1e6 / timUs);
+    }
+}
+
+int main(void){
+    srand(2812);
+    printf("PCLK %llu Hz, SPI prescaler %d%s, profile %d\n", (unsigned long long)WS2812B_PCLK_HZ, WS2812B_SPI_PRESCALER,
+           WS2812B_SPI_3BIT_SYMBOLS ? " (3-bit symbols)" : "", WS2812B_PROFILE);
+
+    Test_Encoders();
+    Test_Frames(&spiStrip, &Fake_SPI_DMA, Capture_SPI, &spiSymbol_ps);
+    Test_Frames(&timStrip, &Fake_TIM_DMA, Capture_TIM, &timSymbol_ps);
+    CHECK(spiSymbol_ps == WS2812B_SPI_SYMBOL_BITS * WS2812B_SPI_CLK_PS, "SPI symbol of %llu ps", (unsigned long long)spiSymbol_ps);
+    CHECK(timSymbol_ps == WS2812B_TIM_PERIOD * WS2812B_TIM_TICK_PS, "TIM symbol of %llu ps", (unsigned long long)timSymbol_ps);
+    Test_CurrentLimit();
+#if WS2812B_PALETTE_BITS
+    Test_Palette();
+#endif
+    Test_FrameRates();
+    Report_Encoders();
+
+    printf("%s: %d failure(s)\n", failures ? "FAILED" : "passed", failures);
+    return failures != 0;
+}